@@ -0,0 +1,106 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#ifndef COMPRESSED_READER_H
+#define COMPRESSED_READER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#ifdef SP_WITH_ZLIB
+#include <zlib.h>
+#endif
+#ifdef SP_WITH_LZMA
+#include <lzma.h>
+#endif
+#ifdef SP_WITH_ZSTD
+#include <zstd.h>
+#endif
+
+#define COMPRESSION_NONE 0
+#define COMPRESSION_GZIP 1
+#define COMPRESSION_XZ 2
+#define COMPRESSION_ZSTD 3
+
+/** Number of bytes that are needed to detect the compression format of a file. */
+#define COMPRESSION_MAGIC_SIZE 6
+/** Size of the blocks of compressed data that are read from the file. */
+#define COMPRESSED_BLOCK_SIZE (1 << 16)
+
+/**
+ * @brief Streaming reader of gzip, xz and zstd files. The file is decompressed block by block, so it is never inflated
+ * in memory. Each format needs its library (zlib, liblzma or libzstd) when the project is built.
+ */
+class CompressedReader {
+
+private:
+
+    /** Compressed file. */
+    std::ifstream input;
+    /** Compression format of the file: COMPRESSION_GZIP, COMPRESSION_XZ or COMPRESSION_ZSTD. */
+    int format{COMPRESSION_NONE};
+    /** Buffer for the compressed data. */
+    std::vector<char> input_buffer;
+    /** True if all the compressed data has been read from the file. */
+    bool input_finished{false};
+    /** True if the compressed stream has ended. */
+    bool stream_finished{false};
+#ifdef SP_WITH_ZLIB
+    /** State of the gzip decoder. */
+    z_stream zlib_stream{};
+#endif
+#ifdef SP_WITH_LZMA
+    /** State of the xz decoder. */
+    lzma_stream lzma_state = LZMA_STREAM_INIT;
+#endif
+#ifdef SP_WITH_ZSTD
+    /** State of the zstd decoder. */
+    ZSTD_DStream *zstd_stream{nullptr};
+    /** Compressed data that the zstd decoder hasn't consumed yet. */
+    ZSTD_inBuffer zstd_input{nullptr, 0, 0};
+#endif
+
+    /**
+     * @brief Read the next block of compressed data into input_buffer.
+     * @return Number of bytes that were read. 0 if the file has ended.
+     */
+    std::size_t FillInput();
+
+public:
+
+    /**
+     * @brief Detect the compression format of a file from its first bytes.
+     * @param magic: First bytes of the file (at least COMPRESSION_MAGIC_SIZE, the missing ones must be 0).
+     * @return COMPRESSION_GZIP, COMPRESSION_XZ, COMPRESSION_ZSTD or COMPRESSION_NONE if it isn't compressed. If the
+     * output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] static int DetectCompression(const char *magic);
+
+    /**
+     * @brief Constructor for CompressedReader. The program ends if the file can't be opened, it isn't compressed or
+     * the support of its format hasn't been built.
+     * @param path: Path of the compressed file.
+     */
+    explicit CompressedReader(const std::string &path);
+
+    /**
+     * @brief Destructor for CompressedReader.
+     */
+    ~CompressedReader();
+
+    CompressedReader(const CompressedReader &) = delete;
+    CompressedReader &operator = (const CompressedReader &) = delete;
+
+    /**
+     * @brief Decompress the next bytes of the file.
+     * @param buffer: Buffer where the decompressed bytes will be stored.
+     * @param size: Size of the buffer.
+     * @return Number of bytes that were stored. It is only lower than size when the file ends, and 0 if it has
+     * already ended. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] std::size_t Read(char *buffer, std::size_t size);
+};
+
+#endif //COMPRESSED_READER_H
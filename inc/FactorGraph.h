@@ -12,10 +12,37 @@
 #include <fstream>
 #include <algorithm>
 #include <random>
-#include <unordered_map>
+#include <numeric>
+#include <atomic>
+#include <memory>
+#include "Metrics.h"
 
 using std::vector;
 
+#define TRAIL_ASSIGNMENT 0
+#define TRAIL_SATISFIED 1
+#define TRAIL_REMOVED 2
+
+/** Minimum size in bytes of the chunks of a DIMACS file that are parsed in parallel. */
+#define DIMACS_CHUNK_SIZE (1 << 20)
+/** Initial size in bytes of the buffer where a compressed DIMACS file is decompressed. */
+#define DIMACS_STREAM_BUFFER_SIZE (1 << 20)
+/** Minimum number of edges of each block when the literal adjacency is built in parallel. */
+#define ADJACENCY_BLOCK_SIZE (1 << 16)
+/** Number of clauses of each block of a random formula. Each block has its own random engine, so the formula doesn't
+ * depend on the number of threads. */
+#define RANDOM_BLOCK_SIZE (1 << 14)
+
+/** First bytes of a binary factor graph file (see FactorGraph::WriteBinary). */
+#define FG_BINARY_MAGIC "SPFG"
+/** Version of the binary factor graph format. */
+#define FG_BINARY_VERSION 1
+/** Flag of the binary factor graph format: the file stores the surveys of the edges. */
+#define FG_BINARY_SURVEYS 1
+
+/** WalkSAT checks if its try has been cancelled every WALKSAT_CANCEL_CHECK + 1 flips. */
+#define WALKSAT_CANCEL_CHECK 255
+
 /** Create definition for uvector. Stands for an unsigned vector of the standard library. */
 typedef vector<unsigned int> uvector;
 /** Create definition for clause. Stands for an int vector of the standard library. */
@@ -25,6 +52,335 @@ typedef vector<vector<unsigned int>> umatrix;
 /** Create definition for wmatrix. Stands for a double matrix of the standard library. */
 typedef vector<vector<double>> wmatrix;
 
+/**
+ * @brief Edge of the factor graph. An edge joins a clause with one of its literals and stores the survey (weight) of
+ * that connection.
+ */
+struct Edge {
+    /** Literal of the edge. It is positive if the variable appears as positive and negative in other case. */
+    int literal;
+    /** Clause of the edge. */
+    unsigned int clause;
+    /** Position of the edge inside the literal adjacency (LiteralClauses and LiteralEdges) of its literal. */
+    unsigned int occurrence;
+    /** Survey (weight) of the edge. */
+    double survey;
+};
+
+/**
+ * @brief Entry of the decimation trail of FactorGraph. Each entry records a change made by PartialAssignment, so it can
+ * be undone.
+ */
+struct TrailEntry {
+    /** Type of the change: TRAIL_ASSIGNMENT (a variable was assigned), TRAIL_SATISFIED (a clause was satisfied) or
+     * TRAIL_REMOVED (a false literal was removed from a clause). */
+    int type;
+    /** Index of the assigned variable (TRAIL_ASSIGNMENT) or clause that was changed (TRAIL_SATISFIED, TRAIL_REMOVED). */
+    unsigned int id;
+};
+
+/**
+ * @brief State of a WalkSAT try. It is updated incrementally after each flip, so a flip only visits the clauses where
+ * the flipped variable appears.
+ */
+struct WalkSATState {
+    /** Current assignment of each variable. */
+    vector<char> assignment;
+    /** Number of true live literals of each clause. */
+    uvector true_count;
+    /** XOR of the true variables of each clause. When a clause has a single true literal, it is its variable. */
+    uvector true_xor;
+    /** Number of clauses that would become unsatisfied if each variable is flipped. */
+    uvector break_count;
+    /** Active clauses that are not satisfied by the current assignment. */
+    uvector unsatisfied;
+    /** Position of each clause inside unsatisfied (-1 if the clause is satisfied). */
+    vector<int> unsatisfied_positions;
+#ifdef SP_METRICS
+    /** Number of flips made by the tries that have used the state. */
+    std::size_t flips{0};
+    /** Number of tries that have used the state. */
+    std::size_t tries{0};
+#endif
+};
+
+/**
+ * @brief Non-owning view over a contiguous range of elements. It is used to return parts of the flat adjacency
+ * arrays of FactorGraph without copying them.
+ */
+template <typename T>
+class View {
+
+private:
+
+    /** First element of the range. */
+    const T *first{nullptr};
+    /** Element after the last element of the range. */
+    const T *last{nullptr};
+
+public:
+
+    /**
+     * @brief Empty constructor. Creates an empty view.
+     */
+    View() = default;
+
+    /**
+     * @brief Constructor for View.
+     * @param first: First element of the range.
+     * @param last: Element after the last element of the range.
+     */
+    View(const T *first, const T *last) : first(first), last(last) {}
+
+    /**
+     * @brief Getter for the first element of the range.
+     * @return Pointer to the first element of the range.
+     */
+    [[nodiscard]] const T *begin() const {
+        return this->first;
+    }
+
+    /**
+     * @brief Getter for the end of the range.
+     * @return Pointer to the element after the last element of the range.
+     */
+    [[nodiscard]] const T *end() const {
+        return this->last;
+    }
+
+    /**
+     * @brief Getter for the size of the range.
+     * @return Number of elements of the range.
+     */
+    [[nodiscard]] std::size_t size() const {
+        return this->last - this->first;
+    }
+
+    /**
+     * @brief Check if the range is empty.
+     * @return True if the range has no elements.
+     */
+    [[nodiscard]] bool empty() const {
+        return this->first == this->last;
+    }
+
+    /**
+     * @brief Access operator.
+     * @param index: Position of the element inside the range.
+     * @return A const reference to the element.
+     */
+    [[nodiscard]] const T &operator [] (std::size_t index) const {
+        return this->first[index];
+    }
+};
+
+/**
+ * @brief Vector with copy-on-write semantics. Copying a CowVector only shares its elements, and they are copied the
+ * first time that one of the copies is modified. It is used for the arrays of FactorGraph, so a copy of a graph (a
+ * snapshot) is cheap and only the arrays that the copy modifies are duplicated.
+ * Detach and the members that replace or reallocate the elements (reserve, resize, assign and clear) copy them if they
+ * are shared. The non-const access operator, data, begin, end, push_back and pop_back don't check the ownership, so the
+ * loops that modify the elements don't pay for it: the vector must be detached before it is modified through them
+ * (FactorGraph detaches its arrays once at the start of each function that modifies them). The copy is not
+ * synchronized: a CowVector that is shared must not be modified concurrently from several threads before calling
+ * Detach.
+ */
+template <typename T>
+class CowVector {
+
+private:
+
+    /** Elements of the vector, shared with its copies. */
+    std::shared_ptr<vector<T>> elements{std::make_shared<vector<T>>()};
+
+public:
+
+    /**
+     * @brief Empty constructor. Creates an empty vector.
+     */
+    CowVector() = default;
+
+    /**
+     * @brief Constructor from a standard vector.
+     * @param values: Elements of the vector.
+     */
+    CowVector(vector<T> values) : elements(std::make_shared<vector<T>>(std::move(values))) {}
+
+    /**
+     * @brief Copy the elements if they are shared with another CowVector, so they can be modified.
+     * @return A reference to the elements.
+     */
+    vector<T> &Detach() {
+        if (this->elements.use_count() > 1) {
+            this->elements = std::make_shared<vector<T>>(*this->elements);
+        }
+        return *this->elements;
+    }
+
+    /**
+     * @brief Getter for the elements.
+     * @return A const reference to the elements. If the output of this function is discarded, the compiler will raise
+     * a warning.
+     */
+    [[nodiscard]] const vector<T> &get() const {
+        return *this->elements;
+    }
+
+    /**
+     * @brief Getter for the size of the vector.
+     * @return Number of elements of the vector.
+     */
+    [[nodiscard]] std::size_t size() const {
+        return this->elements->size();
+    }
+
+    /**
+     * @brief Check if the vector is empty.
+     * @return True if the vector has no elements.
+     */
+    [[nodiscard]] bool empty() const {
+        return this->elements->empty();
+    }
+
+    /**
+     * @brief Access operator.
+     * @param index: Position of the element.
+     * @return A const reference to the element.
+     */
+    [[nodiscard]] const T &operator [] (std::size_t index) const {
+        return (*this->elements)[index];
+    }
+
+    /**
+     * @brief Access operator. The vector must be detached before the element is modified.
+     * @param index: Position of the element.
+     * @return A reference to the element.
+     */
+    [[nodiscard]] T &operator [] (std::size_t index) {
+        return (*this->elements)[index];
+    }
+
+    /**
+     * @brief Getter for the elements.
+     * @return A const pointer to the first element.
+     */
+    [[nodiscard]] const T *data() const {
+        return this->elements->data();
+    }
+
+    /**
+     * @brief Getter for the elements. The vector must be detached before the elements are modified.
+     * @return A pointer to the first element.
+     */
+    [[nodiscard]] T *data() {
+        return this->elements->data();
+    }
+
+    /**
+     * @brief Getter for the first element.
+     * @return A const pointer to the first element.
+     */
+    [[nodiscard]] const T *begin() const {
+        return this->elements->data();
+    }
+
+    /**
+     * @brief Getter for the end of the vector.
+     * @return A const pointer to the element after the last one.
+     */
+    [[nodiscard]] const T *end() const {
+        return this->elements->data() + this->elements->size();
+    }
+
+    /**
+     * @brief Getter for the first element. The vector must be detached before the elements are modified.
+     * @return A pointer to the first element.
+     */
+    [[nodiscard]] T *begin() {
+        return this->elements->data();
+    }
+
+    /**
+     * @brief Getter for the end of the vector. The vector must be detached before the elements are modified.
+     * @return A pointer to the element after the last one.
+     */
+    [[nodiscard]] T *end() {
+        return this->elements->data() + this->elements->size();
+    }
+
+    /**
+     * @brief Getter for the last element.
+     * @return A const reference to the last element.
+     */
+    [[nodiscard]] const T &back() const {
+        return this->elements->back();
+    }
+
+    /**
+     * @brief Add an element at the end of the vector. The vector must be detached.
+     * @param value: Element to add.
+     */
+    void push_back(const T &value) {
+        this->elements->push_back(value);
+    }
+
+    /**
+     * @brief Remove the last element. The vector must be detached.
+     */
+    void pop_back() {
+        this->elements->pop_back();
+    }
+
+    /**
+     * @brief Remove all the elements. If they are shared, the vector stops sharing them without copying them.
+     */
+    void clear() {
+        if (this->elements.use_count() > 1) {
+            this->elements = std::make_shared<vector<T>>();
+        } else {
+            this->elements->clear();
+        }
+    }
+
+    /**
+     * @brief Reserve memory for a number of elements. The elements are copied if they are shared.
+     * @param size: Number of elements.
+     */
+    void reserve(std::size_t size) {
+        this->Detach().reserve(size);
+    }
+
+    /**
+     * @brief Change the number of elements. The elements are copied if they are shared.
+     * @param size: New number of elements.
+     */
+    void resize(std::size_t size) {
+        this->Detach().resize(size);
+    }
+
+    /**
+     * @brief Replace the elements by size copies of value. If they are shared, the vector stops sharing them
+     * without copying them.
+     * @param size: New number of elements.
+     * @param value: Value of the elements.
+     */
+    void assign(std::size_t size, const T &value) {
+        if (this->elements.use_count() > 1) {
+            this->elements = std::make_shared<vector<T>>(size, value);
+        } else {
+            this->elements->assign(size, value);
+        }
+    }
+};
+
+#ifdef SP_COUNT_ALLOCATIONS
+/**
+ * Number of calls to the global operator new. It is only available when SP_COUNT_ALLOCATIONS is defined and it is only
+ * increased by the operator new of sp_alloc_check (it is always 0 in the other executables).
+ */
+extern std::atomic<std::size_t> AllocationCount;
+#endif
+
 /**
  * @brief Operator == for two clauses.
  * @param c1: First clause.
@@ -53,8 +409,12 @@ vector<std::string> SplitString(const std::string& str, char delim = ' ');
  * @brief Class for handle the factor graph representation of a CNF formula.
  *  The variables in a DIMACS file are in the range [1,NumberVariables]
  *  and the 0 variable means that the clause has finished. The representation that is used goes from
- *  [0,NumberVariables). So when we are saying that PositiveClausesOfVariable[0] we are getting the clauses where the
- *  variable 1 is positive.
+ *  [0,NumberVariables). So when we are saying that getPositiveClausesOfVariable(1) we are getting the clauses where
+ *  the variable 1 is positive. The graph is stored in compressed sparse row format: a flat edge vector grouped by
+ *  clause and a flat vector of clauses grouped by literal, each one indexed by an offsets vector.
+ *  The decimation is made in place: the clause ids never change, the live edges of each clause and the live
+ *  occurrences of each literal are kept at the start of their ranges and the satisfied clauses are moved out of the
+ *  active clauses. Every change is saved in a trail, so it can be undone with Backtrack.
  **/
 
 [[nodiscard]] uvector genIndexVector(unsigned int N);
@@ -63,26 +423,59 @@ class FactorGraph {
 
 private:
 
-    /** Vector that storage the positive variables of each clause. */
-    umatrix PositiveVariablesOfClause;
-    /** Vector that storage the negative variables of each clause. */
-    umatrix NegativeVariablesOfClause;
-    /** Vector that storage for each variable the clauses where that variable appear as positive. */
-    umatrix PositiveClausesOfVariable;
-    /** Vector that storage for each variable the clauses where that variable appear as negative. */
-    umatrix NegativeClausesOfVariable;
-    /** Vector that storage the edge pis (weight). */
-    wmatrix EdgeWeights;
-    /** Variable that storage the number of clauses. */
+    /** The microbenchmarks of sp_bench measure the private kernels. */
+    friend struct SolverBench;
+
+    /** Edges of the graph grouped by clause. Inside each clause the live edges appear before the removed ones. When the
+     * graph is loaded the positive literals appear before the negative ones. */
+    CowVector<Edge> Edges;
+    /** Offsets of each clause inside Edges. The edges of clause c are in [ClauseOffsets[c], ClauseOffsets[c + 1]). */
+    CowVector<unsigned int> ClauseOffsets;
+    /** Offsets of each literal inside LiteralClauses. The literal slot of the variable v is 2 * (v - 1) when the
+     * variable is positive and 2 * (v - 1) + 1 when the variable is negative. */
+    CowVector<unsigned int> LiteralOffsets;
+    /** Clauses where each literal appears, grouped by literal slot. */
+    CowVector<unsigned int> LiteralClauses;
+    /** Index inside Edges of each occurrence stored in LiteralClauses. */
+    CowVector<unsigned int> LiteralEdges;
+    /** Number of live edges of each clause. */
+    CowVector<unsigned int> ClauseSizes;
+    /** Number of live occurrences of each literal slot. */
+    CowVector<unsigned int> LiteralSizes;
+    /** Ids of the clauses. The first NumberClauses ids are the active (not satisfied) clauses. */
+    CowVector<unsigned int> ActiveClauses;
+    /** Position of each clause inside ActiveClauses. */
+    CowVector<unsigned int> ClausePositions;
+    /** Assignment of each variable: 1 if true, -1 if false and 0 if it is not assigned. */
+    CowVector<int> Assignment;
+    /** Changes made by PartialAssignment in order. */
+    CowVector<TrailEntry> Trail;
+    /** Clauses that have become unit and haven't been propagated yet. An entry can be stale (the clause could have been
+     * satisfied or emptied later), so it is checked when it is taken. */
+    CowVector<unsigned int> UnitQueue;
+    /** Number of active clauses without live literals. */
+    int EmptyClauses{0};
+    /** Number of calls to Backtrack that have undone changes. The trail after a backtrack can have the same size as
+     * before it with different changes, so the epoch tells them apart. */
+    std::size_t BacktrackEpoch{0};
+    /** Number of literals of every clause of the formula if all of them have the same number of literals and no
+     * clause repeats a variable, in other case 0. */
+    unsigned int ClauseWidth{0};
+    /** Variable that storage the number of active clauses. */
     int NumberClauses{0};
     /** Variable that storage the number of variables. */
     int NumberVariables{0};
     /** Seed for the RNG */
     int seed{0};
+    /** Metrics of the assignments, the propagations and WalkSAT. WalkSAT is const, it adds its counts when its threads
+     * finish. */
+    mutable SolverMetrics metrics;
 
     /**
      * @brief Read a DIMACS file (the clauses of the DIMACS file must be in conjunctive normal form).
-     * and overwrite the Positive and Negative vectors by it's content.
+     * and overwrite the edge and adjacency vectors by it's content. The file is mapped in memory and the clauses section
+     * is split in chunks (DIMACS_CHUNK_SIZE) that are parsed in parallel in two passes: the first one counts the
+     * literals and clauses of each chunk and the second one fills the edges. A clause can span several lines.
      * @param path: Path to the file.
      * @param n_clauses: int where the number of clauses that was founded will be stored.
      * @param n_variables: int where the number of variables that was founded will be stored.
@@ -90,11 +483,135 @@ private:
     void ReadDIMACS(const std::string &path, int &n_clauses, int &n_variables);
 
     /**
-     * @brief Function that loads new clauses vectors. It is used in the PartialAssignment function.
-     * @param deleted: Matrix where each row is the clause where the variable of each column will be deleted.
-     * @param satisfied: Vector with the clauses that are satisfied.
+     * @brief Read a DIMACS file compressed with gzip, xz or zstd (see CompressedReader). The file is decompressed and
+     * parsed block by block, so it is never inflated in memory. The literals are parsed straight into the edges.
+     * @param path: Path to the file.
+     * @param n_clauses: int where the number of clauses that was founded will be stored.
+     * @param n_variables: int where the number of variables that was founded will be stored.
+     */
+    void ReadCompressedDIMACS(const std::string &path, int &n_clauses, int &n_variables);
+
+    /**
+     * @brief Move the positive literals of each clause before the negative ones, keeping their order.
+     */
+    void PartitionClauses();
+
+    /**
+     * @brief Function that builds the literal adjacency (LiteralOffsets, LiteralClauses and LiteralEdges) from the
+     * Edges and ClauseOffsets vectors and links each edge with its occurrence. It also resets the decimation state, so
+     * every clause is active and every variable is unassigned.
      */
-    void ApplyNewClauses(const vector<vector<int>> &deleted, const vector<bool> &satisfied);
+    void BuildLiteralAdjacency();
+
+    /**
+     * @brief Read a binary factor graph file written by WriteBinary. The file is mapped in memory and its arrays are
+     * copied to the edge and adjacency vectors without any parsing. The arrays are checked before they are used as
+     * indexes, so a corrupted file exits with an error instead of reading out of range.
+     * @param path: Path to the file.
+     * @param n_clauses: int where the number of clauses of the file will be stored.
+     * @param n_variables: int where the number of variables of the file will be stored.
+     * @return True if the file stores the surveys of the edges.
+     */
+    bool ReadBinary(const std::string &path, int &n_clauses, int &n_variables);
+
+    /**
+     * @brief Reset the decimation state: every edge, occurrence and clause is live, every variable is unassigned and the
+     * trail is empty. The unit clauses of the formula are added to the unit queue and the width of the clauses is
+     * checked (see getClauseWidth).
+     */
+    void ResetDecimation();
+
+    /*
+     * The functions below modify the arrays without checking if they are shared, so the graph must be detached (see
+     * Detach) before calling them.
+     */
+
+    /**
+     * @brief Swap two edges of the same clause keeping LiteralEdges up to date.
+     * @param e1: Index of the first edge.
+     * @param e2: Index of the second edge.
+     */
+    void SwapEdges(unsigned int e1, unsigned int e2);
+
+    /**
+     * @brief Swap two occurrences of the same literal slot keeping the occurrence of their edges up to date.
+     * @param o1: First occurrence.
+     * @param o2: Second occurrence.
+     */
+    void SwapOccurrences(unsigned int o1, unsigned int o2);
+
+    /**
+     * @brief Move the occurrence of an edge out of the live occurrences of its literal.
+     * @param edge: Index of the edge.
+     */
+    void RemoveOccurrence(unsigned int edge);
+
+    /**
+     * @brief Move the occurrence of an edge back to the live occurrences of its literal.
+     * @param edge: Index of the edge.
+     */
+    void RestoreOccurrence(unsigned int edge);
+
+    /**
+     * @brief Mark a clause as satisfied: its occurrences are removed from the literals and the clause is moved out of
+     * the active clauses. The change is saved in the trail.
+     * @param search_clause: Clause that is satisfied.
+     */
+    void SatisfyClause(unsigned int search_clause);
+
+    /**
+     * @brief Remove a false literal from its clause. The change is saved in the trail.
+     * @param edge: Index of the edge of the literal.
+     */
+    void RemoveLiteral(unsigned int edge);
+
+    /**
+     * @brief Getter for the offset of a literal slot inside the literal adjacency. The offsets are never modified after
+     * the graph is loaded, so they are read through this const getter to keep them shared between snapshots.
+     * @param slot: Literal slot.
+     * @return Index of the first occurrence of the slot in LiteralClauses and LiteralEdges. If the output of this
+     * function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] unsigned int getLiteralOffset(unsigned int slot) const {
+        return this->LiteralOffsets[slot];
+    }
+
+    /**
+     * @brief Initialize a WalkSAT state with a random assignment. The assigned variables keep their assignment.
+     * @param state: State that will be initialized.
+     * @param gen: Random engine used to generate the assignment.
+     */
+    void InitWalkSAT(WalkSATState &state, std::mt19937 &gen) const;
+
+    /**
+     * @brief Flip a variable and update the clause counts, break counts and unsatisfied clauses of a WalkSAT state.
+     * @param state: State that will be updated.
+     * @param variable: Index of the variable that will be flipped.
+     */
+    void FlipVariable(WalkSATState &state, unsigned int variable) const;
+
+    /**
+     * @brief Make a WalkSAT try starting from a random assignment.
+     * @param state: State used by the try. If the try succeeds, its assignment satisfies the formula.
+     * @param gen: Random engine used by the try.
+     * @param max_flips: Maximum number of flips that the try will do.
+     * @param noise: Noise parameter of WalkSAT.
+     * @param best_try: Index of the first try that has succeeded (shared by all the threads). The try is cancelled if
+     * a try with a lower index succeeds.
+     * @param try_index: Index of this try.
+     * @return True if the try has found an assignment that satisfies the formula.
+     */
+    bool WalkSATTry(WalkSATState &state, std::mt19937 &gen, unsigned int max_flips, double noise,
+                    const std::atomic<unsigned int> &best_try, unsigned int try_index) const;
+
+    /**
+     * @brief Assign a variable and update the clauses and the trail (see PartialAssignment). The graph must be
+     * detached.
+     * @param variable_index: Index of the variable that is going to be assigned.
+     * @param assignation: True or false assignation to the variable_index.
+     * @return False if the variable was already assigned (nothing is done), true in other case.
+     */
+    bool AssignVariable(unsigned int variable_index, bool assignation);
 
 public:
 
@@ -104,43 +621,172 @@ public:
     FactorGraph() = default;
 
     /**
-     * @brief Copy constructor for FactorGraph class.
+     * @brief Copy constructor for FactorGraph class. The copy is a snapshot: it shares the arrays of fc and each array
+     * is only copied when one of the graphs modifies it (see CowVector).
      * @param fc: Factor graph to copy.
      */
-    [[maybe_unused]] FactorGraph(const FactorGraph &fc) {
-        this->PositiveClausesOfVariable.clear();
-        this->NegativeClausesOfVariable.clear();
-        this->PositiveVariablesOfClause.clear();
-        this->NegativeVariablesOfClause.clear();
-        this->EdgeWeights.clear();
+    [[maybe_unused]] FactorGraph(const FactorGraph &fc) = default;
 
-        this->PositiveVariablesOfClause = fc.PositiveVariablesOfClause;
-        this->NegativeVariablesOfClause = fc.NegativeVariablesOfClause;
-        this->PositiveClausesOfVariable = fc.PositiveClausesOfVariable;
-        this->NegativeClausesOfVariable = fc.NegativeClausesOfVariable;
-        this->EdgeWeights = fc.EdgeWeights;
-        this->seed = fc.seed;
-
-        this->NumberClauses = fc.NumberClauses;
-        this->NumberVariables = fc.NumberVariables;
-    }
+    /**
+     * @brief Copy the arrays that are shared with other copies of the graph and that can be modified, so the graph is
+     * their only owner. The clause and literal offsets are never modified, so they stay shared. The functions that
+     * modify the graph call it once before their loops, which don't check the ownership again (see CowVector). It must
+     * be called before the graph is modified from several threads at the same time.
+     */
+    void Detach();
 
     /**
      * @brief Constructor for FactorGraph.
-     * @param path: DIMACS file path.
+     * @param path: DIMACS file path. It can also be a DIMACS file compressed with gzip, xz or zstd or a binary factor
+     * graph file (see WriteBinary), which are detected by their first bytes.
      * @param seed: Seed that will be used. Defaults to 1.
      */
     explicit FactorGraph(const std::string &path, int seed = 1);
 
+    /**
+     * @brief Constructor for a random k-SAT formula that is built in memory. Each clause has k different variables
+     * chosen uniformly and each literal is negated with probability 0.5. The clauses are generated in parallel by
+     * blocks of RANDOM_BLOCK_SIZE clauses, so the formula only depends on the arguments.
+     * @param n_variables: Number of variables.
+     * @param alpha: Ratio of clauses to variables. The formula has round(alpha * n_variables) clauses.
+     * @param k: Number of literals of each clause. It can't be greater than n_variables.
+     * @param seed: Seed used to generate the formula and the surveys. Defaults to 1.
+     */
+    FactorGraph(unsigned int n_variables, double alpha, unsigned int k, int seed = 1);
+
+    /**
+     * @brief Write the factor graph to a binary file that can be loaded by the constructor without parsing. The file
+     * stores the formula without the partial assignments (the decimation is undone in a copy of the graph).
+     * The format (version FG_BINARY_VERSION, native byte order) is: the magic bytes FG_BINARY_MAGIC; five 32 bits
+     * unsigned ints with the version, the flags, the number of variables, clauses and edges; ClauseOffsets; the literal
+     * of each edge; LiteralOffsets; LiteralEdges and, if the flag FG_BINARY_SURVEYS is set, 4 bytes of padding (if
+     * they are needed to align it to 8 bytes) and the survey (double) of each edge.
+     * @param path: Path of the file.
+     * @param surveys: If true, the surveys of the edges are stored too. Defaults to false (they are initialized randomly
+     * when the file is loaded).
+     */
+    void WriteBinary(const std::string &path, bool surveys = false) const;
+
+    /**
+     * @brief Get the literal slot of a literal (the index of that literal inside the literal adjacency).
+     * @param literal: Literal (positive or negative variable).
+     * @return 2 * (v - 1) if the literal is the positive variable v and 2 * (v - 1) + 1 if it is negative. If the output
+     * of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] static unsigned int LiteralSlot(int literal) {
+        return 2 * (abs(literal) - 1) + (literal > 0 ? 0 : 1);
+    }
+
     /**
      * @brief Getter for NumberClauses.
-     * @return Integer with the value of NumberClauses. If the output of this function is discarded,
-     * the compiler will raise a warning.
+     * @return Integer with the value of NumberClauses (number of active clauses). If the output of this function is
+     * discarded, the compiler will raise a warning.
      */
     [[nodiscard]] int getNClauses() const {
         return NumberClauses;
     }
 
+    /**
+     * @brief Getter for the number of clauses of the formula, including the satisfied ones. The clause ids are in the
+     * range [0, getNTotalClauses()).
+     * @return Number of clauses of the formula. If the output of this function is discarded, the compiler will raise a
+     * warning.
+     */
+    [[nodiscard]] unsigned int getNTotalClauses() const {
+        return this->ClauseOffsets.empty() ? 0 : this->ClauseOffsets.size() - 1;
+    }
+
+    /**
+     * @brief Getter for the width of the clauses of the formula. The surveys of the edges of a clause whose variables
+     * are different don't depend on each other, so SurveyPropagation computes them together when the width is fixed.
+     * @return Number of literals of every clause (before the decimation) or 0 if the clauses have different widths or
+     * a clause repeats a variable. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] unsigned int getClauseWidth() const {
+        return this->ClauseWidth;
+    }
+
+    /**
+     * @brief Getter for the active clauses.
+     * @return A view of the ids of the active (not satisfied) clauses. If the output of this function is discarded,
+     * the compiler will raise a warning.
+     */
+    [[nodiscard]] View<unsigned int> getActiveClauses() const {
+        return View<unsigned int>(this->ActiveClauses.data(), this->ActiveClauses.data() + this->NumberClauses);
+    }
+
+    /**
+     * @brief Check if a clause is active.
+     * @param search_clause: Clause to look for.
+     * @return True if the clause is not satisfied. If the output of this function is discarded, the compiler will raise
+     * a warning.
+     */
+    [[nodiscard]] bool isClauseActive(unsigned int search_clause) const {
+        return this->ClausePositions[search_clause] < static_cast<unsigned int>(this->NumberClauses);
+    }
+
+    /**
+     * @brief Getter for the assignment of a variable.
+     * @param variable: Variable to look for.
+     * @return 1 if the variable is true, -1 if it is false and 0 if it is not assigned. If the output of this
+     * function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] int getAssignment(int variable) const {
+        return this->Assignment[abs(variable) - 1];
+    }
+
+    /**
+     * @brief Getter for the metrics of the assignments, the unit propagations and WalkSAT. They are only updated when
+     * the code is compiled with SP_METRICS.
+     * @return Metrics of the graph. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] const SolverMetrics &getMetrics() const {
+        return this->metrics;
+    }
+
+    /**
+     * @brief Set every counter and timer of the graph metrics to 0.
+     */
+    void resetMetrics() {
+        this->metrics = SolverMetrics();
+    }
+
+    /**
+     * @brief Getter for the size of the trail.
+     * @return Number of changes saved in the trail. It can be used as a level for Backtrack. If the output of this
+     * function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] std::size_t getTrailSize() const {
+        return this->Trail.size();
+    }
+
+    /**
+     * @brief Getter for the changes saved in the trail after a level.
+     * @param level: Size of the trail (getTrailSize) before the first change that is returned.
+     * @return A view of the entries of the trail from the position level, in the order in which the changes were made.
+     * If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] View<TrailEntry> getTrail(std::size_t level) const {
+        return View<TrailEntry>(this->Trail.data() + level, this->Trail.data() + this->Trail.size());
+    }
+
+    /**
+     * @brief Getter for the backtrack epoch.
+     * @return Number of calls to Backtrack that have undone changes. While it doesn't change, the trail only grows and
+     * getTrail(level) is the list of changes made after the trail had the size level. If the output of this function
+     * is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] std::size_t getBacktrackEpoch() const {
+        return this->BacktrackEpoch;
+    }
+
+    /**
+     * @brief Undo the changes of the trail until it has the given size. The backtrack epoch is increased if a change
+     * is undone.
+     * @param level: Size of the trail (getTrailSize) that is going to be restored.
+     */
+    void Backtrack(std::size_t level);
+
     /**
      * @brief Getter for NumberVariables.
      * @return Integer with the value of NumberVariables. If the output of this function is discarded,
@@ -150,6 +796,15 @@ public:
         return NumberVariables;
     }
 
+    /**
+     * @brief Getter for the number of edges.
+     * @return Number of edges of the graph (sum of the sizes of the clauses of the formula, including the removed
+     * edges). If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] unsigned int getNEdges() const {
+        return this->Edges.size();
+    }
+
     /**
      * @brief Check if the formula is an empty clause.
      * @return True if the formula is an empty clause or false if not. If the output of this function is discarded,
@@ -165,12 +820,7 @@ public:
     * the compiler will raise a warning.
     */
     [[nodiscard]] bool Contradiction() const {
-        for (int i = 0 ; i < this->NumberClauses; i++) {
-            if (this->Clause(i).empty()) {
-                return true;
-            }
-        }
-        return false;
+        return this->EmptyClauses > 0;
     }
 
     /**
@@ -184,110 +834,213 @@ public:
 
     /**
      * @brief Function that return the weights matrix.
-     * @return A const reference to EdgeWeights. If the output of this function is discarded,
-     * the compiler will raise a warning.
+     * @return A matrix where the ith row has the weights of the live edges of the ith active clause. If the output of
+     * this function is discarded, the compiler will raise a warning.
      */
-    [[nodiscard]] const wmatrix & getMatrix() const {
-        return this->EdgeWeights;
-    }
+    [[nodiscard]] wmatrix getMatrix() const;
 
-     /**
-     * @brief Getter for PositiveVariablesOfClause vector.
+    /**
+     * @brief Getter for the edges of a clause.
      * @param search_clause: Clause to look for.
-     * @return A const reference to PositiveVariablesOfClauses. If the output of this function is discarded,
-     * the compiler will raise a warning.
+     * @return A view of the live edges of search_clause. If the output of this function is discarded, the compiler
+     * will raise a warning.
      */
-    [[nodiscard]] const uvector & getPositiveVariablesOfClause(unsigned int search_clause) const {
-        return this->PositiveVariablesOfClause[search_clause];
+    [[nodiscard]] View<Edge> getEdgesOfClause(unsigned int search_clause) const {
+        return View<Edge>(this->Edges.data() + this->ClauseOffsets[search_clause],
+                          this->Edges.data() + this->ClauseOffsets[search_clause] + this->ClauseSizes[search_clause]);
     }
 
     /**
-     * @brief Getter for NegativeVariablesOfClause.
+     * @brief Getter for the offset of a clause inside the edge vector.
      * @param search_clause: Clause to look for.
-     * @return A const reference to NegativeVariablesOfClause. If the output of this function is discarded,
-     * the compiler will raise a warning.
+     * @return Index of the first edge of search_clause. The edge in the position p of the clause has the index
+     * getClauseOffset(search_clause) + p. If the output of this function is discarded, the compiler will raise a
+     * warning.
      */
-    [[nodiscard]] const uvector & getNegativeVariablesOfClause(unsigned int search_clause) const {
-        return this->NegativeVariablesOfClause[search_clause];
+    [[nodiscard]] unsigned int getClauseOffset(unsigned int search_clause) const {
+        return this->ClauseOffsets[search_clause];
     }
 
     /**
-     * @brief Getter for PositiveClausesOfVariable.
+     * @brief Getter for an edge.
+     * @param edge: Index of the edge.
+     * @return A const reference to the edge. If the output of this function is discarded, the compiler will raise a
+     * warning.
+     */
+    [[nodiscard]] const Edge &getEdge(unsigned int edge) const {
+        return this->Edges[edge];
+    }
+
+    /**
+     * @brief Getter for the survey of an edge. This function doesn't check the index, so it can be used in the
+     * SP loops.
+     * @param edge: Index of the edge.
+     * @return The survey of the edge. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] double getSurvey(unsigned int edge) const {
+        return this->Edges[edge].survey;
+    }
+
+    /**
+     * @brief Change the survey of an edge. This function doesn't check the index, so it can be used in the SP loops.
+     * @param edge: Index of the edge.
+     * @param value: New survey of the edge.
+     */
+    void setSurvey(unsigned int edge, double value) {
+        this->Edges.Detach()[edge].survey = value;
+    }
+
+    /**
+     * @brief Change the surveys of the first edges. The edges are detached once for all the surveys.
+     * @param surveys: New surveys, the ith survey is the survey of the ith edge.
+     */
+    template <typename Real>
+    void setSurveys(const vector<Real> &surveys) {
+        Edge *edges = this->Edges.Detach().data();
+        for (std::size_t e = 0; e < surveys.size(); e++) {
+            edges[e].survey = surveys[e];
+        }
+    }
+
+    /**
+     * @brief Change the surveys of a set of edges. The edges are detached once for all the surveys.
+     * @param surveys: Surveys of all the edges, only the surveys of the edges in indexes are used.
+     * @param indexes: Indexes of the edges whose survey is changed.
+     */
+    template <typename Real>
+    void setSurveys(const vector<Real> &surveys, const uvector &indexes) {
+        Edge *edges = this->Edges.Detach().data();
+        for (auto e : indexes) {
+            edges[e].survey = surveys[e];
+        }
+    }
+
+    /**
+     * @brief Getter for the edges where a variable appears as positive.
      * @param variable: Variable to look for.
-     * @return A const reference to PositiveClausesOfVariable. If the output of this function is discarded,
-     * the compiler will raise a warning.
+     * @return A view of the indexes of the live edges where variable appears as positive (in the same order as
+     * getPositiveClausesOfVariable). If the output of this function is discarded, the compiler will raise a warning.
      */
-    [[nodiscard]] const uvector & getPositiveClausesOfVariable(int variable) const {
-        unsigned int variable_index = variable > 0 ? variable - 1 : abs(variable) - 1;
-        return this->PositiveClausesOfVariable[variable_index];
+    [[nodiscard]] View<unsigned int> getPositiveEdgesOfVariable(int variable) const {
+        unsigned int slot = 2 * (abs(variable) - 1);
+        return View<unsigned int>(this->LiteralEdges.data() + this->LiteralOffsets[slot],
+                                  this->LiteralEdges.data() + this->LiteralOffsets[slot] + this->LiteralSizes[slot]);
     }
 
     /**
-     * @brief Getter for NegativeClausesOfVariable.
+     * @brief Getter for the edges where a variable appears as negative.
      * @param variable: Variable to look for.
-     * @return A const reference to NegativeClausesOfVariable. If the output of this function is discarded,
+     * @return A view of the indexes of the live edges where variable appears as negative (in the same order as
+     * getNegativeClausesOfVariable). If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] View<unsigned int> getNegativeEdgesOfVariable(int variable) const {
+        unsigned int slot = 2 * (abs(variable) - 1) + 1;
+        return View<unsigned int>(this->LiteralEdges.data() + this->LiteralOffsets[slot],
+                                  this->LiteralEdges.data() + this->LiteralOffsets[slot] + this->LiteralSizes[slot]);
+    }
+
+     /**
+     * @brief Getter for the positive variables of a clause.
+     * @param search_clause: Clause to look for.
+     * @return A vector with the positive variables of search_clause. If the output of this function is discarded,
+     * the compiler will raise a warning.
+     */
+    [[nodiscard]] uvector getPositiveVariablesOfClause(unsigned int search_clause) const;
+
+    /**
+     * @brief Getter for the negative variables of a clause.
+     * @param search_clause: Clause to look for.
+     * @return A vector with the negative variables of search_clause. If the output of this function is discarded,
      * the compiler will raise a warning.
      */
-    [[nodiscard]] const uvector & getNegativeClausesOfVariable(int variable) const {
-        unsigned int variable_index = variable > 0 ? variable - 1 : abs(variable) - 1;
-        return this->NegativeClausesOfVariable[variable_index];
+    [[nodiscard]] uvector getNegativeVariablesOfClause(unsigned int search_clause) const;
+
+    /**
+     * @brief Getter for the clauses where a variable appears as positive.
+     * @param variable: Variable to look for.
+     * @return A view of the active clauses where variable appears as positive. If the output of this function is discarded,
+     * the compiler will raise a warning.
+     */
+    [[nodiscard]] View<unsigned int> getPositiveClausesOfVariable(int variable) const {
+        unsigned int slot = 2 * (abs(variable) - 1);
+        return View<unsigned int>(this->LiteralClauses.data() + this->LiteralOffsets[slot],
+                                  this->LiteralClauses.data() + this->LiteralOffsets[slot] + this->LiteralSizes[slot]);
     }
 
     /**
-     * @brief Function that returns the unit vars.
-     * @return A vector with the unit variables of the formula. If the output of this function is discarded,
+     * @brief Getter for the clauses where a variable appears as negative.
+     * @param variable: Variable to look for.
+     * @return A view of the active clauses where variable appears as negative. If the output of this function is discarded,
      * the compiler will raise a warning.
      */
-    void getUnitVars(std::unordered_map<unsigned int, bool> &unit_vars) const;
+    [[nodiscard]] View<unsigned int> getNegativeClausesOfVariable(int variable) const {
+        unsigned int slot = 2 * (abs(variable) - 1) + 1;
+        return View<unsigned int>(this->LiteralClauses.data() + this->LiteralOffsets[slot],
+                                  this->LiteralClauses.data() + this->LiteralOffsets[slot] + this->LiteralSizes[slot]);
+    }
 
     /**
-     * @brief Get the index of variable in search_clause
+     * @brief Get the index of variable in search_clause. The decimation reorders the edges of the clauses, so the index
+     * is only valid until the graph is modified.
      * @param search_clause: Clause to look for.
      * @param variable: Variable to look for.
-     * @return The index of the variable in search_clause. If an the variable doesn't appear in the clause, the
-     * execution will be aborted with the exit_status = 1;
+     * @return The position of the edge of the variable among the live edges of search_clause. If the variable
+     * doesn't appear in the clause, the execution will be aborted with the exit_status = 1;
      */
     [[nodiscard]] unsigned int getIndexOfVariable(unsigned int search_clause, int variable) const;
 
     /**
      * @brief Change the weight of a specific edge.
      * @param search_clause: Clause of the edge.
-     * @param position: Position of the variable inside the EdgeWeights vector.
+     * @param position: Position of the variable inside the clause.
      * @param value: New weight of the edge.
      */
     void setEdgeW(unsigned int search_clause, unsigned int position, double value);
 
-    /**
-     * @brief Check if a variable appears in a search_clause.
-     * @param search_clause: Clause where to look for the variable.
-     * @param variable: Variable that will be looked in Clause.
-     * @param positive: Will be true if the variable was founded in positives nodes, false in other case.
-     * @return Index of the variable in the search_clause. If not found the return value is -1. If the output of this
-     * function is discarded, the compiler will raise a warning.
-     */
-    [[nodiscard]] int Connection(unsigned int search_clause, unsigned int variable, bool &positive) const;
 
     /**
      * @brief Change the weights vector using random numbers in the range (0,1).
      */
     void ChangeWeights();
 
+    /**
+     * @brief Setter for the seed of the graph, which is used by ChangeWeights and WalkSAT.
+     * @param value: New seed.
+     */
+    void setSeed(int value) {
+        this->seed = value;
+    }
+
     /**
      * @brief Function that performs Unit Propagation. If a variable is a unit variable, the assignment of that variable
      * is defined by the value of that variable (if the unit variable appears as positive, the assignment will be true
-     * and if the variable appears as negative the assignment will be false).
+     * and if the variable appears as negative the assignment will be false). The clauses become unit when
+     * PartialAssignment removes their literals, so they are taken from a work queue instead of scanning the formula.
+     * @return False if a contradiction (a clause without live literals) was found. In that case the propagation stops
+     * as soon as the empty clause appears. True in other case.
      */
-    void UnitPropagation();
+    bool UnitPropagation();
 
     /**
      * @brief Function that performs a partial assignment. If a variable is true, we have to remove the clauses where
      * that variable appears as positive (because that clause will be satisfied) and remove that variable from the
-     * clause where the variable appears as negative.
+     * clause where the variable appears as negative. The changes are made in place and saved in the trail, so the cost
+     * is proportional to the number of clauses of the variable. If the variable is already assigned, nothing is done.
      * @param variable_index: Index of the variable that is going to be checked.
      * @param assignation: True or false assignation to the variable_index.
      */
     void PartialAssignment(unsigned int variable_index, bool assignation);
 
+    /**
+     * @brief Function that assigns a set of variables in one call (see PartialAssignment). The assignments stop as
+     * soon as a clause loses its last literal. The unit clauses are not propagated (see UnitPropagation), so the
+     * contradiction and empty formula checks (Contradiction and EmptyClause) can be made once for the whole set.
+     * @param literals: Literals that are made true: the variable v is assigned to true by v and to false by -v. The
+     * variables that are already assigned are skipped.
+     * @return False if a contradiction (a clause without live literals) was found, true in other case.
+     */
+    bool PartialAssignment(const vector<int> &literals);
+
     /**
      * @brief Return a complete clause.
      * @param search_clause: Clause to search.
@@ -314,33 +1067,6 @@ public:
      */
     [[nodiscard]] static bool SatisfiesC(const vector<bool> &assignment, const clause &search_clause) ;
 
-    /**
-     * @brief Function that checks if an assignment satisfies or not the formula.
-     * @param assign: Boolean vector with the assignment (true if positive false if negative).
-     * @param sat: Boolean vector where the ith position will be true if the ith clause is satisfied with the given
-     * assignment and false if it is not satisfied.
-     * @param indexes: Indexes of the clauses that will be checked.
-     * @return true if the formula is satisfied and false if not.
-     */
-    bool SatisfiesF(const vector<bool> &assign, vector<bool> &sat, const vector<unsigned int> &indexes) const;
-
-    /**
-     * @brief Function that gets the break count. From a set of satisfied clauses and given a clause C,
-     * this funtion will flip each variable in C and it will count the number of clauses that are not satisfied after
-     * flipping each variable.
-     * @param sat_clauses: Boolean vector where the ith position will be true if the ith clause is satisfied with the
-     * given assign. False if it is not satisfied.
-     * @param s_clause: Clause that will be used to calculate the break count.
-     * @param assign: True assigment that will be used.
-     * @param min_index: Index of the variable with the lower break count.
-     * @param freebie: This paramater will be -1 if there is not any freebie move and a positive integer indicating
-     * the index of the variable that will be used for the freebie move.
-     * @return A vector (same size than s_clause) with the break count of each variable of the clause.
-     * The compiler will raise a warning if the output is discarded.
-     */
-    [[nodiscard]] uvector getBreakCount(const vector<bool> &sat_clauses, const clause &s_clause,
-                                        const vector<bool> &assign, unsigned int &min_index, int &freebie) const;
-
     /**
      * @brief WalkSAT algorithm.
      * @param max_tries: Maximum number of tries that the algorithm will do.
@@ -349,12 +1075,19 @@ public:
      * break count.
      * @param fixed_variables: Vector that will be used to pre-assign variables. If the ith position is 1 the ith
      * variable will be true, -1 will be false and if 0, walksat will be able to change it's assignment.
+     * The variables assigned by PartialAssignment keep their assignment and only the active clauses are searched.
+     * @param n_threads: Number of threads that run tries concurrently (needs OpenMP). Each try has its own random
+     * stream and the result is always the one of the first try that succeeds, so it doesn't depend on the number of
+     * threads. When a try succeeds, the tries after it are cancelled. Defaults to 1.
+     * @param cancel: If it is not null, no try is started once it is true (another solver has found a solution).
+     * Defaults to null.
      * @return A boolean vector with the assignment (if found) that satisfies the formula. If the algorithm hasn't found
      * an assignment, it will return an empty vector. If the output of this function is discarded,
      * the compiler will raise a warning.
      */
     [[nodiscard]] vector<bool>
-    WalkSAT(unsigned int max_tries, unsigned int max_flips, double noise, const vector<int>& fixed_variables) const;
+    WalkSAT(unsigned int max_tries, unsigned int max_flips, double noise, const vector<int>& fixed_variables,
+            int n_threads = 1, const std::atomic<bool> *cancel = nullptr) const;
 
     /**
      * @brief Check if an assignment satisfies the formula.
@@ -0,0 +1,133 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#ifndef METRICS_H
+#define METRICS_H
+
+/** Phases whose wall time is measured by SolverMetrics. */
+#define PHASE_SP 0
+#define PHASE_UPDATE 1
+#define PHASE_BIASES 2
+#define PHASE_PARTIAL_ASSIGNMENT 3
+#define PHASE_UNIT_PROPAGATION 4
+#define PHASE_WALKSAT 5
+#define N_PHASES 6
+
+#include <chrono>
+#include <cstddef>
+#include <sstream>
+#include <string>
+
+/**
+ * @brief Counters and timers of a solver run. They are only updated when the code is compiled with SP_METRICS (see the
+ * SP_METRICS CMake option), in other case the instrumentation is removed and every value stays at 0. The phases are
+ * nested: the time of SP includes the time of the updates and the time of UnitPropagation includes the assignments it
+ * makes (that are not counted as decimated variables).
+ */
+struct SolverMetrics {
+    /** Number of calls to SP. */
+    std::size_t sp_calls{0};
+    /** Number of SP iterations (sweeps over the graph or rounds of residual updates). */
+    std::size_t sweeps{0};
+    /** Number of surveys computed by the updates. */
+    std::size_t edge_updates{0};
+    /** Number of variables assigned by PartialAssignment. */
+    std::size_t decimated_variables{0};
+    /** Number of variables assigned by UnitPropagation. */
+    std::size_t propagated_units{0};
+    /** Number of WalkSAT flips. */
+    std::size_t flips{0};
+    /** Number of WalkSAT tries, each one restarts from a random assignment. */
+    std::size_t restarts{0};
+    /** Wall time in seconds of each phase (PHASE_SP, PHASE_UPDATE...). */
+    double phase_seconds[N_PHASES]{};
+
+    /**
+     * @brief Add the counters and the times of other metrics.
+     * @param other: Metrics that are added.
+     * @return Reference to this object.
+     */
+    SolverMetrics &operator += (const SolverMetrics &other) {
+        this->sp_calls += other.sp_calls;
+        this->sweeps += other.sweeps;
+        this->edge_updates += other.edge_updates;
+        this->decimated_variables += other.decimated_variables;
+        this->propagated_units += other.propagated_units;
+        this->flips += other.flips;
+        this->restarts += other.restarts;
+        for (int phase = 0; phase < N_PHASES; phase++) {
+            this->phase_seconds[phase] += other.phase_seconds[phase];
+        }
+        return *this;
+    }
+
+    /**
+     * @brief Write the metrics as a JSON object. The field enabled is false if the code was compiled without
+     * SP_METRICS.
+     * @return String with the JSON object. If the output of this function is discarded, the compiler will raise a
+     * warning.
+     */
+    [[nodiscard]] std::string ToJSON() const {
+        static const char *phase_names[N_PHASES] = {"sp", "update", "biases", "partial_assignment", "unit_propagation",
+                                                    "walksat"};
+        std::ostringstream out;
+#ifdef SP_METRICS
+        out << "{\"enabled\": true, ";
+#else
+        out << "{\"enabled\": false, ";
+#endif
+        out << "\"sp_calls\": " << this->sp_calls << ", \"sweeps\": " << this->sweeps << ", \"edge_updates\": "
+            << this->edge_updates << ", \"decimated_variables\": " << this->decimated_variables
+            << ", \"propagated_units\": " << this->propagated_units << ", \"flips\": " << this->flips
+            << ", \"restarts\": " << this->restarts << ", \"seconds\": {";
+        for (int phase = 0; phase < N_PHASES; phase++) {
+            out << (phase == 0 ? "" : ", ") << "\"" << phase_names[phase] << "\": " << this->phase_seconds[phase];
+        }
+        out << "}}";
+        return out.str();
+    }
+};
+
+/**
+ * @brief Timer that adds the wall time between its construction and its destruction to a phase of SolverMetrics.
+ */
+class ScopedTimer {
+
+private:
+
+    /** Time of the phase. */
+    double &seconds;
+    /** Time when the timer was created. */
+    std::chrono::steady_clock::time_point start;
+
+public:
+
+    /**
+     * @brief Start the timer.
+     * @param seconds: Time of the phase, the measured time is added to it.
+     */
+    explicit ScopedTimer(double &seconds) : seconds(seconds), start(std::chrono::steady_clock::now()) {}
+
+    /**
+     * @brief Stop the timer and add the measured time to the phase.
+     */
+    ~ScopedTimer() {
+        this->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->start).count();
+    }
+
+    ScopedTimer(const ScopedTimer &) = delete;
+    ScopedTimer &operator = (const ScopedTimer &) = delete;
+};
+
+#ifdef SP_METRICS
+/** Add value to a counter of metrics. */
+#define METRICS_ADD(metrics, counter, value) ((metrics).counter += (value))
+/** Measure the time until the end of the current scope as time of phase. */
+#define METRICS_TIMER(metrics, phase) ScopedTimer metrics_timer_##phase((metrics).phase_seconds[phase])
+#else
+#define METRICS_ADD(metrics, counter, value) ((void) 0)
+#define METRICS_TIMER(metrics, phase) ((void) 0)
+#endif
+
+#endif // METRICS_H
@@ -0,0 +1,111 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <mutex>
+#include "SurveyPropagation.h"
+#include "WorkStealingPool.h"
+
+/** Result of a portfolio attempt that was cancelled before it started. */
+#define PORTFOLIO_CANCELLED -3
+
+/**
+ * @brief Parameters of an attempt of the portfolio.
+ */
+struct PortfolioAttempt {
+    /** Seed of the solver. It selects the initial surveys, the order of the updates and the WalkSAT tries. */
+    int seed{1};
+    /** Fraction of variables fixed by SIDF. If it is 0, SID is used instead. */
+    double fraction{0.04};
+    /** Number of iterations of SID (only used if fraction is 0). */
+    unsigned int sid_iters{100};
+    /** Damping of the surveys (see SurveyPropagation::setDamping). */
+    double damping{0.0};
+    /** If true, the damping is increased when the surveys oscillate. */
+    bool adaptive_damping{true};
+    /** Noise of WalkSAT. */
+    double noise{0.57};
+};
+
+/**
+ * @brief Portfolio of SID and SIDF attempts with different seeds and parameters that run concurrently on the same
+ * formula. Each attempt works on its own snapshot of the graph (the arrays of the formula are shared, see CowVector).
+ * The first attempt whose assignment satisfies the formula cancels the others, so more threads reduce the time until a
+ * solution is found.
+ */
+class Portfolio {
+
+private:
+
+    /** Graph of the formula. The attempts and the check of their assignments only read it. */
+    FactorGraph graph;
+    /** Attempts of the portfolio. */
+    vector<PortfolioAttempt> attempts;
+    /** Result of each attempt of the last run (SAT, PROB_UNSAT, CONTRADICTION or SP_UNCONVERGED). */
+    vector<int> results;
+    /** Index of the attempt that has found the solution in the last run (-1 if there is none). */
+    int winner{-1};
+    /** Pool that runs the attempts. */
+    WorkStealingPool pool;
+
+public:
+
+    /**
+     * @brief Constructor for the Portfolio class.
+     * @param graph: FactorGraph object with the formula. The portfolio keeps a snapshot of it.
+     * @param n_threads: Number of attempts that run at the same time. Defaults to the number of hardware threads.
+     */
+    explicit Portfolio(const FactorGraph &graph, unsigned int n_threads = std::thread::hardware_concurrency()) :
+            graph(graph), pool(n_threads) {}
+
+    /**
+     * @brief Add an attempt to the portfolio.
+     * @param attempt: Parameters of the attempt.
+     */
+    void AddAttempt(const PortfolioAttempt &attempt) {
+        this->attempts.push_back(attempt);
+    }
+
+    /**
+     * @brief Add k attempts made from base. The attempt i has the seed base.seed + i. The fraction of SIDF is divided
+     * by 1, 2 and 4, the WalkSAT noise is moved by 0, -0.05 and +0.05 and the damping is base.damping or halfway from
+     * it to 1 (up to DAMPING_MAX) in turns, so the attempts explore different decimations and local searches.
+     * @param k: Number of attempts.
+     * @param base: Parameters of the first attempt.
+     */
+    void AddAttempts(unsigned int k, const PortfolioAttempt &base);
+
+    /**
+     * @brief Run the attempts until one of them finds an assignment that satisfies the formula. The assignment is
+     * checked with the formula before the other attempts are cancelled.
+     * @param assignment: Boolean vector where the assignment of the winner will be stored (empty if there is none).
+     * @return SAT if an attempt has found an assignment. In other case, the combined result of the attempts:
+     * PROB_UNSAT if an attempt has finished the decimation without finding it, CONTRADICTION if every attempt has found
+     * a contradiction and SP_UNCONVERGED if the other attempts haven't converged (or there are no attempts). If the
+     * output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] int Run(vector<bool> &assignment);
+
+    /**
+     * @brief Getter for the attempt that has found the solution in the last run.
+     * @return Index of the attempt or -1 if no attempt has found a solution. If the output of this function is
+     * discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] int getWinner() const {
+        return this->winner;
+    }
+
+    /**
+     * @brief Getter for the results of the attempts in the last run. The attempts that were cancelled have the result
+     * that they returned when they stopped and the ones that were cancelled before starting have PORTFOLIO_CANCELLED.
+     * @return Result of each attempt. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] const vector<int> &getResults() const {
+        return this->results;
+    }
+};
+
+#endif // PORTFOLIO_H
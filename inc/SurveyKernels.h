@@ -0,0 +1,133 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#ifndef SURVEY_KERNELS_H
+#define SURVEY_KERNELS_H
+
+/** Edge index that is never skipped by CavityProduct. */
+#define NO_EDGE 0xFFFFFFFFu
+
+#include <cstddef>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief Scalar version of CavityProduct. It is used when the vector instructions aren't available and for the last
+ * elements of the list in the AVX2 version.
+ * @tparam Real: Scalar type of the surveys.
+ * @param surveys: Survey of each edge.
+ * @param edges: Indexes of the edges.
+ * @param n: Number of edges.
+ * @param skip: Edge that is not included in the product.
+ * @return Product of (1 - survey) of the edges, except skip. If the output of this function is discarded, the compiler
+ * will raise a warning.
+ */
+template <typename Real>
+[[nodiscard]] inline Real ScalarCavityProduct(const Real *surveys, const unsigned int *edges, std::size_t n,
+                                              unsigned int skip) {
+    Real product = 1.0;
+    for (std::size_t i = 0; i < n; i++) {
+        if (edges[i] != skip) {
+            product *= 1 - surveys[edges[i]];
+        }
+    }
+    return product;
+}
+
+/**
+ * @brief Product of (1 - survey) of a list of edges without one of them (the cavity of the skipped edge). The surveys
+ * are gathered with AVX-512 or AVX2 if the code is compiled for them (see SP_NATIVE_ARCH), so the order of the
+ * multiplications (and the rounding) depends on the instruction set.
+ * @param surveys: Survey of each edge.
+ * @param edges: Indexes of the edges. They must be lower than 2^31.
+ * @param n: Number of edges.
+ * @param skip: Edge that is not included in the product (NO_EDGE to include all of them).
+ * @return Product of (1 - survey) of the edges, except skip. If the output of this function is discarded, the compiler
+ * will raise a warning.
+ */
+[[nodiscard]] inline float CavityProduct(const float *surveys, const unsigned int *edges, std::size_t n,
+                                         unsigned int skip) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    const __m512 ones = _mm512_set1_ps(1.0f);
+    const __m512i skipped = _mm512_set1_epi32(static_cast<int>(skip));
+    __m512 product = ones;
+    for (std::size_t i = 0; i < n; i += 16) {
+        // The last block only loads the remaining edges.
+        __mmask16 lanes = n - i >= 16 ? 0xFFFF : static_cast<__mmask16>((1u << (n - i)) - 1);
+        __m512i indexes = _mm512_maskz_loadu_epi32(lanes, edges + i);
+        lanes &= _mm512_cmpneq_epi32_mask(indexes, skipped);
+        __m512 weights = _mm512_sub_ps(ones, _mm512_mask_i32gather_ps(ones, lanes, indexes, surveys, 4));
+        product = _mm512_mask_mul_ps(product, lanes, product, weights);
+    }
+    return _mm512_reduce_mul_ps(product);
+#elif defined(__AVX2__)
+    const __m256 ones = _mm256_set1_ps(1.0f);
+    const __m256i skipped = _mm256_set1_epi32(static_cast<int>(skip));
+    __m256 product = ones;
+    float lanes[8];
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256i indexes = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(edges + i));
+        __m256 weights = _mm256_sub_ps(ones, _mm256_i32gather_ps(surveys, indexes, 4));
+        // The factor of the skipped edge is replaced by 1.
+        weights = _mm256_blendv_ps(weights, ones, _mm256_castsi256_ps(_mm256_cmpeq_epi32(indexes, skipped)));
+        product = _mm256_mul_ps(product, weights);
+    }
+    _mm256_storeu_ps(lanes, product);
+    return lanes[0] * lanes[1] * lanes[2] * lanes[3] * lanes[4] * lanes[5] * lanes[6] * lanes[7] *
+           ScalarCavityProduct(surveys, edges + i, n - i, skip);
+#else
+    return ScalarCavityProduct(surveys, edges, n, skip);
+#endif
+}
+
+/**
+ * @brief Product of (1 - survey) of a list of edges without one of them (the cavity of the skipped edge). The surveys
+ * are gathered with AVX-512 or AVX2 if the code is compiled for them (see SP_NATIVE_ARCH), so the order of the
+ * multiplications (and the rounding) depends on the instruction set.
+ * @param surveys: Survey of each edge.
+ * @param edges: Indexes of the edges. They must be lower than 2^31.
+ * @param n: Number of edges.
+ * @param skip: Edge that is not included in the product (NO_EDGE to include all of them).
+ * @return Product of (1 - survey) of the edges, except skip. If the output of this function is discarded, the compiler
+ * will raise a warning.
+ */
+[[nodiscard]] inline double CavityProduct(const double *surveys, const unsigned int *edges, std::size_t n,
+                                          unsigned int skip) {
+#if defined(__AVX512F__) && defined(__AVX512VL__)
+    const __m512d ones = _mm512_set1_pd(1.0);
+    const __m256i skipped = _mm256_set1_epi32(static_cast<int>(skip));
+    __m512d product = ones;
+    for (std::size_t i = 0; i < n; i += 8) {
+        // The last block only loads the remaining edges.
+        __mmask8 lanes = n - i >= 8 ? 0xFF : static_cast<__mmask8>((1u << (n - i)) - 1);
+        __m256i indexes = _mm256_maskz_loadu_epi32(lanes, edges + i);
+        lanes &= _mm256_cmpneq_epi32_mask(indexes, skipped);
+        __m512d weights = _mm512_sub_pd(ones, _mm512_mask_i32gather_pd(ones, lanes, indexes, surveys, 8));
+        product = _mm512_mask_mul_pd(product, lanes, product, weights);
+    }
+    return _mm512_reduce_mul_pd(product);
+#elif defined(__AVX2__)
+    const __m256d ones = _mm256_set1_pd(1.0);
+    const __m128i skipped = _mm_set1_epi32(static_cast<int>(skip));
+    __m256d product = ones;
+    double lanes[4];
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i indexes = _mm_loadu_si128(reinterpret_cast<const __m128i *>(edges + i));
+        __m256d weights = _mm256_sub_pd(ones, _mm256_i32gather_pd(surveys, indexes, 8));
+        // The factor of the skipped edge is replaced by 1 (the 32 bits mask is extended to 64 bits).
+        __m256i skip_mask = _mm256_cvtepi32_epi64(_mm_cmpeq_epi32(indexes, skipped));
+        weights = _mm256_blendv_pd(weights, ones, _mm256_castsi256_pd(skip_mask));
+        product = _mm256_mul_pd(product, weights);
+    }
+    _mm256_storeu_pd(lanes, product);
+    return lanes[0] * lanes[1] * lanes[2] * lanes[3] * ScalarCavityProduct(surveys, edges + i, n - i, skip);
+#else
+    return ScalarCavityProduct(surveys, edges, n, skip);
+#endif
+}
+
+#endif // SURVEY_KERNELS_H
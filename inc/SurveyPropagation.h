@@ -10,19 +10,41 @@
 #define SAT 1
 #define PROB_UNSAT 0
 #define CONTRADICTION -2
+#define SWEEP_SEQUENTIAL 0
+#define SWEEP_SYNCHRONOUS 1
+#define SWEEP_COLOURED 2
+#define SWEEP_RESIDUAL 3
+#define RESIDUAL_BUCKETS 64
+/** The incremental SP falls back to a complete SP after (number of live edges / INCREMENTAL_FRACTION) updates. */
+#define INCREMENTAL_FRACTION 8
+/** Number of consecutive changes of direction of the maximum residual that are considered an oscillation. */
+#define DAMPING_OSCILLATIONS 4
+/** Maximum damping reached by the adaptive damping. */
+#define DAMPING_MAX 0.9
+/** Range of the clause widths that are updated by the fixed width kernels (see SurveyPropagation::UpdateClause). */
+#define FIXED_WIDTH_MIN 3
+#define FIXED_WIDTH_MAX 5
 
 #include <utility>
 #include "FactorGraph.h"
+#include "SurveyKernels.h"
 
 /**
- * @brief Class for the implementation of the survey propagation algorithm.
+ * @brief Class for the implementation of the survey propagation algorithm. The graph stores the surveys as double, SP
+ * works on a copy of them in the precision of the solver that is written back to the graph when SP finishes.
+ * @tparam Real: Scalar type of the surveys and the products used by SP (double or float). With float, SP reads half of
+ * the memory in each sweep. Defaults to double.
  */
+template <typename Real = double>
 class SurveyPropagation {
 
 private:
 
+    /** The microbenchmarks of sp_bench measure the private kernels. */
+    friend struct SolverBench;
+
     /** Factor Graph of the formula that is going to be checked. */
-    FactorGraph *AssociatedGraph;
+    std::unique_ptr<FactorGraph> AssociatedGraph;
     /** Number of iterations of the algorithm. */
     unsigned int n_iters;
     /** Precision value. */
@@ -35,15 +57,383 @@ private:
     unsigned int walksat_flips;
     /** Noise for WalkSAT algorithm. */
     double walksat_noise;
+    /** Number of threads used by WalkSAT. */
+    int walksat_threads{1};
     /** Seed for the RNG. */
     int seed;
+    /** If true, SP will use the cached literal products (UpdateCached) instead of recomputing them (Update). */
+    bool cached_products{true};
+    /** Width of the clauses of the formula if it is between FIXED_WIDTH_MIN and FIXED_WIDTH_MAX, in other case 0. It
+     * is chosen when the graph is loaded and the sweeps update the clauses that keep all their literals with the
+     * kernels of that width. */
+    unsigned int clause_width{0};
+    /** Survey of each edge in the precision of the solver. It is loaded from the graph when SP starts. */
+    vector<Real> surveys;
+    /** Product of (1 - survey) of the non zero factors of each literal slot (see FactorGraph::LiteralSlot). */
+    vector<Real> literal_products;
+    /** Number of factors (1 - survey) that are exactly zero in each literal slot. */
+    uvector literal_zeros;
+    /** Damping of the updates: the new survey is damping * old survey + (1 - damping) * computed survey. */
+    double damping{0.0};
+    /** If true, the damping is increased when the maximum residual oscillates. */
+    bool adaptive_damping{false};
+    /** Damping used by the current SP call. It starts at damping and is increased by the adaptive damping. */
+    Real current_damping{0.0};
+    /** Maximum residual of the previous iteration (-1 before the first one). */
+    double previous_residual{-1.0};
+    /** Direction of the last change of the maximum residual: 1 if it grew, -1 if it fell and 0 if it is unknown. */
+    int residual_trend{0};
+    /** Number of consecutive changes of direction of the maximum residual. */
+    unsigned int oscillations{0};
+    /** Sweep mode of SP: SWEEP_SEQUENTIAL, SWEEP_SYNCHRONOUS, SWEEP_COLOURED or SWEEP_RESIDUAL. */
+    int sweep_mode{SWEEP_SEQUENTIAL};
+    /** Number of threads used by the parallel sweeps. */
+    int threads{1};
+    /** Buffer where the synchronous sweep stores the new surveys. */
+    vector<Real> next_surveys;
+    /** Clauses of each colour. The clauses of a colour don't share any variable. */
+    umatrix colour_classes;
+    /** Scratch vector with the positions of the edges of a clause, shuffled in the sequential sweep. */
+    uvector clause_positions;
+    /** Scratch vector with the order of the colours, shuffled in the coloured sweep. */
+    uvector colour_indexes;
+    /** Residual of each edge: accumulated estimated change of its survey since its last update (residual mode). */
+    vector<Real> residuals;
+    /** Edges whose residual is higher than the precision. The bucket b has the residuals in [2^-b, 2^(1-b)), the
+     * last bucket has all the lower residuals and the first one all the higher residuals. */
+    umatrix residual_buckets;
+    /** Bucket of each edge (-1 if the edge is not queued). */
+    vector<int> edge_buckets;
+    /** Position of each queued edge inside its bucket. */
+    uvector bucket_positions;
+    /** Every bucket before first_bucket is empty. */
+    unsigned int first_bucket{0};
+    /** Number of edges in the buckets. */
+    unsigned int queued_edges{0};
+    /** Number of live edges. Each iteration of the residual mode makes that number of updates. */
+    unsigned int live_edges{0};
+    /** If true, SP only updates the neighbourhood of the changes made to the graph since the last SP call. */
+    bool incremental{false};
+    /** True if surveys, the cached products and the non zero counts match the graph at the end of the last SP call, so
+     * the incremental mode can start from them. */
+    bool warm{false};
+    /** Size of the trail of the graph at the end of the last SP call. */
+    std::size_t synced_trail{0};
+    /** Backtrack epoch of the graph at the end of the last SP call. If it has changed, the trail after synced_trail
+     * is not the list of changes since that call. */
+    std::size_t synced_epoch{0};
+    /** Number of non zero surveys of the live edges of each clause (incremental mode). */
+    uvector clause_nonzero;
+    /** Number of non zero surveys of the live edges (incremental mode). */
+    unsigned int nonzero_surveys{0};
+    /** Edges updated by the current incremental SP call. Only their surveys are saved in the graph. */
+    uvector updated_edges;
+    /** Variables that have been assigned or have lost a clause since the last incremental SP call. */
+    uvector changed_variables;
+    /** Flag that cancels the solver when it is true (see setCancelFlag). */
+    const std::atomic<bool> *cancel{nullptr};
+    /** Metrics of SP and CalculateBiases. The metrics of the decimation and WalkSAT are kept by the graph. */
+    SolverMetrics metrics;
+#ifdef SP_COUNT_ALLOCATIONS
+    /** Maximum number of allocations made by a SP iteration (the first iteration of each call is not counted). */
+    std::size_t iteration_allocations{0};
+#endif
 
     /**
      * @brief Function that implements the SP-Update function.
-     * @param search_clause: Clause that is going going to be searched.
-     * @param variable: Variable that is going to be searched.
+     * @param edge: Index of the edge (clause and variable) whose survey is going to be updated.
+     * @return Absolute difference between the new and the old survey of the edge.
+     */
+    double Update(unsigned int edge);
+
+    /**
+     * @brief Function that computes the new survey of an edge (SP-Update) without saving it.
+     * @param edge: Index of the edge (clause and variable) whose survey is going to be computed.
+     * @return The new survey of the edge. If the output of this function is discarded, the compiler will raise a
+     * warning.
+     */
+    [[nodiscard]] Real ComputeSurvey(unsigned int edge) const;
+
+    /**
+     * @brief Function that implements the SP-Update function using the cached literal products. The cavity products are
+     * obtained dividing the cached product by the factor of the edge, so the cost of an update is O(k). The cached
+     * products of the literal of the edge are updated with the new survey.
+     * @param edge: Index of the edge (clause and variable) whose survey is going to be updated.
+     * @return Absolute difference between the new and the old survey of the edge.
+     */
+    double UpdateCached(unsigned int edge);
+
+    /**
+     * @brief Function that computes the new survey of an edge using the cached literal products without saving it.
+     * @param edge: Index of the edge (clause and variable) whose survey is going to be computed.
+     * @return The new survey of the edge. If the output of this function is discarded, the compiler will raise a
+     * warning.
+     */
+    [[nodiscard]] Real ComputeSurveyCached(unsigned int edge) const;
+
+    /**
+     * @brief Function that computes the factor of the variable of an edge in the surveys of the other edges of its
+     * clause (see SurveyFactor). The cavity products are computed from the surveys of the clauses of the variable.
+     * @param edge: Index of the edge.
+     * @param literal: Literal of the edge.
+     * @return Factor of the variable. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] Real CavityFactor(unsigned int edge, int literal) const;
+
+    /**
+     * @brief Function that computes the factor of the variable of an edge in the surveys of the other edges of its
+     * clause (see SurveyFactor) using the cached literal products.
+     * @param edge: Index of the edge.
+     * @param literal: Literal of the edge.
+     * @return Factor of the variable. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] Real CavityFactorCached(unsigned int edge, int literal) const;
+
+    /**
+     * @brief Function that saves the new survey of an edge, damped.
+     * @param edge: Index of the edge.
+     * @param survey: New survey of the edge.
+     * @return Absolute difference between the new (not damped) and the old survey of the edge.
+     */
+    double SaveSurvey(unsigned int edge, Real survey);
+
+    /**
+     * @brief Function that saves the new survey of an edge, damped, and replaces its factor in the cached products of
+     * its literal.
+     * @param edge: Index of the edge.
+     * @param survey: New survey of the edge.
+     * @return Absolute difference between the new (not damped) and the old survey of the edge.
+     */
+    double SaveSurveyCached(unsigned int edge, Real survey);
+
+    /**
+     * @brief Function that chooses the kernels used by the sweeps from the width of the clauses of the graph (see
+     * clause_width).
+     */
+    void ChooseClauseWidth() {
+        unsigned int width = this->AssociatedGraph->getClauseWidth();
+        this->clause_width = width >= FIXED_WIDTH_MIN && width <= FIXED_WIDTH_MAX ? width : 0;
+    }
+
+    /**
+     * @brief Function that checks if a clause can be updated with the kernels of clause_width.
+     * @param clause: Clause to check.
+     * @return True if the formula has a fixed width and the clause keeps all its literals. If the output of this
+     * function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] bool FixedWidth(unsigned int clause) const {
+        return this->clause_width != 0 && this->AssociatedGraph->getEdgesOfClause(clause).size() == this->clause_width;
+    }
+
+    /**
+     * @brief Function that computes the new surveys of the edges of a clause with K live literals without saving them.
+     * The factor of each variable is computed once and the survey of each edge is the product of the factors of the
+     * other variables, so a clause costs K factors instead of K * (K - 1). The surveys are the ones computed edge by
+     * edge (with the cached products, up to the rounding of the divisions).
+     * @tparam K: Number of live literals of the clause. The loops have a fixed length and are unrolled by the compiler.
+     * @param clause: Clause whose surveys are computed. Its variables must be different.
+     * @param clause_surveys: Array where the K surveys are stored, in the order of the edges of the clause.
+     */
+    template <unsigned int K>
+    void ComputeClause(unsigned int clause, Real *clause_surveys) const;
+
+    /**
+     * @brief Function that updates the edges of a clause with K live literals (see ComputeClause). The surveys of the
+     * edges don't depend on each other, so they are saved after all of them are computed.
+     * @tparam K: Number of live literals of the clause.
+     * @param clause: Clause whose surveys are updated. Its variables must be different.
+     * @param trivial: Will be false if a survey of the clause is not zero after the update.
+     * @return Maximum absolute difference between the new and the old surveys of the clause.
+     */
+    template <unsigned int K>
+    double UpdateClause(unsigned int clause, bool &trivial);
+
+    /**
+     * @brief Function that calls ComputeClause with the width of the formula.
+     * @param clause: Clause with clause_width live literals.
+     * @param clause_surveys: Array where the surveys are stored.
+     */
+    void ComputeFixedClause(unsigned int clause, Real *clause_surveys) const;
+
+    /**
+     * @brief Function that calls UpdateClause with the width of the formula.
+     * @param clause: Clause with clause_width live literals.
+     * @param trivial: Will be false if a survey of the clause is not zero after the update.
+     * @return Maximum absolute difference between the new and the old surveys of the clause.
+     */
+    double UpdateFixedClause(unsigned int clause, bool &trivial);
+
+    /**
+     * @brief Function that computes the literal products and the zero counts from the current surveys.
+     */
+    void InitProducts();
+
+    /**
+     * @brief Function that copies the surveys of the graph to surveys, converting them to the precision of the solver.
+     */
+    void LoadSurveys();
+
+    /**
+     * @brief Function that writes surveys back to the graph.
+     */
+    void StoreSurveys();
+
+    /**
+     * @brief Function that computes the factor of the survey that corresponds to a variable of the clause.
+     * @param product_u: Product of (1 - survey) of the clauses where the variable appears with the opposite sign.
+     * @param product_s: Product of (1 - survey) of the clauses where the variable appears with the same sign (except
+     * the updated clause).
+     * @param pi_0: Product of (1 - survey) of all the clauses of the variable (except the updated clause).
+     * @return pi_u / (pi_u + pi_s + pi_0) or 0 if the denominator is 0. If the output of this function is discarded,
+     * the compiler will raise a warning.
+     */
+    [[nodiscard]] Real SurveyFactor(Real product_u, Real product_s, Real pi_0) const;
+
+    /**
+     * @brief Function that colours the clauses of the graph (greedy colouring) so the clauses of a colour don't share
+     * any variable. The result is saved in colour_classes.
+     */
+    void ColourClauses();
+
+    /**
+     * @brief Function that updates every edge once, in random order, using a single thread.
+     * @param generator: Random engine generator.
+     * @param clauses_indexes: Vector with the indexes of the clauses. It will be shuffled.
+     * @param trivial: Will be true if all the surveys are zero after the sweep.
+     * @return Maximum absolute difference between the new and the old surveys. If the output of this function is
+     * discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] double SequentialSweep(std::mt19937 &generator, uvector &clauses_indexes, bool &trivial);
+
+    /**
+     * @brief Function that updates every edge once using the surveys of the previous sweep (Jacobi). The new surveys are
+     * computed in parallel in next_surveys and then copied to the graph.
+     * @param trivial: Will be true if all the surveys are zero after the sweep.
+     * @return Maximum absolute difference between the new and the old surveys. If the output of this function is
+     * discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] double SynchronousSweep(bool &trivial);
+
+    /**
+     * @brief Function that updates every edge once. The colours are visited in random order and the clauses of each
+     * colour are updated in parallel.
+     * @param generator: Random engine generator.
+     * @param trivial: Will be true if all the surveys are zero after the sweep.
+     * @return Maximum absolute difference between the new and the old surveys. If the output of this function is
+     * discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] double ColouredSweep(std::mt19937 &generator, bool &trivial);
+
+    /**
+     * @brief Function that empties the buckets of the residual mode and resizes its vectors.
+     */
+    void ResetResiduals();
+
+    /**
+     * @brief Function that puts an edge in the bucket of its residual. If the edge was in other bucket, it is moved.
+     * @param edge: Index of the edge. Its residual must be higher than 0.
+     */
+    void QueueResidual(unsigned int edge);
+
+    /**
+     * @brief Function that removes an edge from its bucket.
+     * @param edge: Index of a queued edge.
+     */
+    void DequeueResidual(unsigned int edge);
+
+    /**
+     * @brief Function that computes the exact residual (the change of the survey if it was updated) of every live edge
+     * and queues the edges whose residual is higher than the precision. The surveys are not modified.
+     * @param trivial: Will be true if all the surveys are zero.
+     * @return Maximum residual. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] double SeedResiduals(bool &trivial);
+
+    /**
+     * @brief Function that computes the factor of a literal in the surveys of the clauses where it appears (see
+     * SurveyFactor), without removing the factor of the edge of each clause.
+     * @param literal: Literal (positive or negative variable).
+     * @return Factor of the literal. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] Real LiteralFactor(int literal) const;
+
+    /**
+     * @brief Function that adds the estimated change of the surveys to the residuals of the edges that depend on a
+     * literal after its factor has changed. A survey of a clause is the product of the factors of the other literals,
+     * so its change is estimated as the survey times the relative change of the factor.
+     * @param literal: Literal whose factor has changed.
+     * @param edge: Updated edge, the edges of its clause are not changed.
+     * @param before: Factor of the literal before the update.
+     * @param after: Factor of the literal after the update.
+     */
+    void PropagateResidual(int literal, unsigned int edge, Real before, Real after);
+
+    /**
+     * @brief Function that computes the residual of an edge: the change of its survey if it was updated.
+     * @param edge: Index of the edge.
+     * @return Absolute difference between the new and the current survey (without damping). If the output of this
+     * function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] Real ExactResidual(unsigned int edge) const;
+
+    /**
+     * @brief Function that updates the edge with the highest residual until the buckets are empty or max_updates
+     * updates have been made. After each update, the estimated change of the surveys that use it (the other edges of
+     * the clauses of its variable) is added to their residuals (see PropagateResidual), so the edges whose inputs have
+     * changed most are updated first.
+     * @param max_updates: Maximum number of updates.
+     */
+    void PropagateResiduals(std::size_t max_updates);
+
+    /**
+     * @brief Function that runs PropagateResiduals with as many updates as live edges. When the buckets are emptied,
+     * the exact residuals are computed again (see SeedResiduals), so SP only converges if no update would change a
+     * survey by more than the precision.
+     * @param trivial: Will be true if all the surveys are zero.
+     * @return Maximum exact residual if the buckets were emptied or the residual of a queued edge (higher than the
+     * precision) in other case. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] double ResidualSweep(bool &trivial);
+
+    /**
+     * @brief Function that prepares the incremental mode after a complete SP call has converged: it computes the
+     * cached products, the non zero counts and empties the buckets.
+     */
+    void InitWarmState();
+
+    /**
+     * @brief Function that computes the cached product and the zero count of a literal from its live edges.
+     * @param literal: Literal (positive or negative variable).
      */
-    void Update(unsigned int search_clause, int variable);
+    void InitLiteralProducts(int literal);
+
+    /**
+     * @brief Function that computes the exact residuals of the edges that use the products of a variable (the other
+     * edges of the clauses where it appears) and queues the ones that are higher than the precision.
+     * @param variable: Variable whose products have changed.
+     */
+    void QueueNeighbourhood(int variable);
+
+    /**
+     * @brief Function that implements the incremental SP. It starts from the surveys of the last call and reads the
+     * changes of the graph from its trail: the products of the variables whose clauses were satisfied or assigned are
+     * computed again and the frontier (the edges of the clauses that lost a literal and the edges that use the changed
+     * products) is queued in the residual buckets. Then the updates spread from the frontier while the residuals are
+     * higher than the precision, so the cost depends on the size of the changes instead of the size of the graph.
+     * @param trivial: Will be true if all the surveys are zero.
+     * @return SP_CONVERGED if the buckets have been emptied or SP_UNCONVERGED if the number of live edges divided by
+     * INCREMENTAL_FRACTION updates were not enough. In that case the updated surveys are saved in the graph, so a
+     * complete SP can start from them.
+     */
+    [[nodiscard]] int IncrementalSP(bool &trivial);
+
+    /**
+     * @brief Function that tracks the direction of the maximum residual of each iteration. If it changes of direction
+     * DAMPING_OSCILLATIONS consecutive times, the surveys are oscillating and the distance between current_damping and 1
+     * is halved (up to DAMPING_MAX).
+     * @param residual: Maximum residual of the last iteration.
+     */
+    void TrackOscillations(double residual);
 
     /**
      * @brief Function that implements the SP function.
@@ -57,10 +447,18 @@ private:
      * @param positive_w: Vector where the positive biases of each variable will be stored.
      * @param negative_w: Vector where the negative biases of each variable will be stored.
      * @param zero_w: Vector where the zero biases of each variable will be stored.
-     * @param max_index: Index of the variable that with the largest difference between the positive and negative bias.
+     * @param max_index: Variable (starting at 1) with the largest difference between the positive and negative bias. It
+     * is 0 if every difference is 0.
      */
     void CalculateBiases(vector<double> &positive_w, vector<double> &negative_w, vector<double> &zero_w, int &max_index);
 
+    /**
+     * @brief Copy the assignment of the graph (made by the decimation and the unit propagation). The variables that are
+     * not assigned are false.
+     * @param true_assignment: Boolean vector where the assignment will be stored.
+     */
+    void GraphAssignment(vector<bool> &true_assignment) const;
+
 public:
 
     /**
@@ -79,21 +477,167 @@ public:
                                double bound = 1e-16, unsigned int w_iters = 1000, unsigned int flips = 100,
                                double noise = 0.57) {
         this->seed = seed;
-        this->AssociatedGraph = new FactorGraph(path, this->seed);
+        this->AssociatedGraph = std::make_unique<FactorGraph>(path, this->seed);
+        this->n_iters = n_iters;
+        this->precision = precision;
+        this->lower_bound = bound;
+        this->walksat_iters = w_iters;
+        this->walksat_flips = flips;
+        this->walksat_noise = noise;
+        this->ChooseClauseWidth();
+    }
+
+    /**
+     * @brief Constructor for the Survey Propagation class from a graph that is already loaded. The solver works on a
+     * snapshot of the graph (with its surveys and its seed): the arrays are shared with graph until the solver modifies
+     * them, so a formula can be parsed once and used by several solvers.
+     * @param graph: FactorGraph object with the formula that is going to be used.
+     * @param seed: Seed for the RNG. Defaults to 1.
+     * @param n_iters: Maximum number of iterations. Defaults to 1000.
+     * @param precision: Precision of the algorithm. Defaults to 0.1.
+     * @param bound: If a survey is lower than bound, it will be set to 0.
+     * @param w_iters: Number of iteration for WalkSAT algorithm. Defaults to 1000.
+     * @param flips: Number of flips for WalkSAT algorithm. Defaults to 100.
+     * @param noise: Noise parameter for WalkSAT algorithm. Defaults to 0.57.
+     */
+    explicit SurveyPropagation(const FactorGraph &graph, int seed = 1, unsigned int n_iters = 10e3,
+                               double precision = 10e-3,
+                               double bound = 1e-16, unsigned int w_iters = 1000, unsigned int flips = 100,
+                               double noise = 0.57) {
+        this->seed = seed;
+        this->AssociatedGraph = std::make_unique<FactorGraph>(graph);
         this->n_iters = n_iters;
         this->precision = precision;
         this->lower_bound = bound;
         this->walksat_iters = w_iters;
         this->walksat_flips = flips;
         this->walksat_noise = noise;
+        this->ChooseClauseWidth();
     }
 
     /**
      * @brief Destructor for the SurveyPropagation class.
      */
-    ~SurveyPropagation() {
-        delete this->AssociatedGraph;
+    ~SurveyPropagation() = default;
+
+    /**
+     * @brief Select the sweep mode of SP.
+     * @param cached: If true (default), SP keeps the per literal products of (1 - survey) and each update costs O(k).
+     * If false, each update recomputes the products from the surveys of the neighbour edges.
+     */
+    void setCachedProducts(bool cached) {
+        this->cached_products = cached;
+    }
+
+    /**
+     * @brief Select the sweep mode of SP and the number of threads. The parallel modes need OpenMP, without it they
+     * run in a single thread.
+     * @param mode: SWEEP_SEQUENTIAL (default), SWEEP_SYNCHRONOUS (all the surveys are computed from the ones of the
+     * previous sweep), SWEEP_COLOURED (the clauses that don't share variables are updated concurrently) or
+     * SWEEP_RESIDUAL (the edges whose inputs have changed most are updated first and the edges whose inputs haven't
+     * changed are not updated; it runs in a single thread).
+     * @param n_threads: Number of threads used by the parallel modes. Defaults to 1.
+     */
+    void setSweepMode(int mode, int n_threads = 1) {
+        this->sweep_mode = mode;
+        this->threads = n_threads < 1 ? 1 : n_threads;
+    }
+
+    /**
+     * @brief Select a flag that cancels the solver: once it is true, SP stops at the end of its current iteration
+     * (returning SP_UNCONVERGED), SID doesn't start another iteration and WalkSAT doesn't start another try. It is used
+     * to stop the solvers of a portfolio when one of them has found a solution.
+     * @param flag: Flag that is checked by the solver (null to disable the cancellation). It must outlive the calls.
+     */
+    void setCancelFlag(const std::atomic<bool> *flag) {
+        this->cancel = flag;
+    }
+
+    /**
+     * @brief Draw new random surveys with the seed of the solver. The graph takes the seed of the solver, so WalkSAT
+     * uses it too. Without it, the solvers made from the same graph start from the same surveys.
+     */
+    void RandomizeSurveys() {
+        this->AssociatedGraph->setSeed(this->seed);
+        this->AssociatedGraph->ChangeWeights();
+        this->warm = false;
+    }
+
+    /**
+     * @brief Select the number of threads that run WalkSAT tries concurrently. It needs OpenMP, without it the tries
+     * run in a single thread. The result doesn't depend on the number of threads.
+     * @param n_threads: Number of threads used by WalkSAT.
+     */
+    void setWalkSATThreads(int n_threads) {
+        this->walksat_threads = n_threads < 1 ? 1 : n_threads;
+    }
+
+    /**
+     * @brief Setter for the noise parameter of WalkSAT.
+     * @param noise: Noise parameter for WalkSAT algorithm.
+     */
+    void setWalkSATNoise(double noise) {
+        this->walksat_noise = noise;
+    }
+
+    /**
+     * @brief Select the incremental mode. Once a complete SP call has converged, the next calls start from its surveys
+     * and only update the neighbourhood of the changes made to the graph since the last call (see IncrementalSP),
+     * instead of sweeping the whole graph. If the graph is backtracked or the changes spread to a big part of the graph
+     * (see INCREMENTAL_FRACTION), a complete SP is made instead. The complete calls use the sweep mode (see
+     * setSweepMode).
+     * @param value: True to enable the incremental mode. Defaults to false.
+     */
+    void setIncremental(bool value) {
+        this->incremental = value;
+        this->warm = false;
+    }
+
+    /**
+     * @brief Select the damping of the survey updates. A damped update only moves the survey part of the way to its
+     * new value, which stops the oscillations that don't let SP converge near the threshold. The convergence is checked
+     * with the undamped changes.
+     * @param value: Damping in [0, 1): the new survey is value * old survey + (1 - value) * computed survey. 0 (default)
+     * disables it.
+     * @param adaptive: If true, the damping of each SP call starts at value and is increased each time the maximum
+     * residual oscillates (see TrackOscillations). Defaults to false.
+     */
+    void setDamping(double value, bool adaptive = false) {
+        this->damping = value < 0.0 ? 0.0 : value;
+        this->adaptive_damping = adaptive;
+    }
+
+    /**
+     * @brief Getter for the metrics of the solver: the counters and timers of SP and CalculateBiases plus the ones of
+     * the assignments, the unit propagations and WalkSAT made on its graph. They are only updated when the code is
+     * compiled with SP_METRICS (see SolverMetrics::ToJSON for the JSON output).
+     * @return Metrics of the solver. If the output of this function is discarded, the compiler will raise a warning.
+     */
+    [[nodiscard]] SolverMetrics getMetrics() const {
+        SolverMetrics metrics = this->metrics;
+        metrics += this->AssociatedGraph->getMetrics();
+        return metrics;
+    }
+
+    /**
+     * @brief Set every counter and timer of the solver metrics (and the ones of its graph) to 0.
+     */
+    void resetMetrics() {
+        this->metrics = SolverMetrics();
+        this->AssociatedGraph->resetMetrics();
+    }
+
+#ifdef SP_COUNT_ALLOCATIONS
+    /**
+     * @brief Getter for the maximum number of heap allocations made by a SP iteration. The first iteration of each SP
+     * call (where the buffers are allocated) is not counted.
+     * @return Maximum number of allocations of a SP iteration. If the output of this function is discarded, the
+     * compiler will raise a warning.
+     */
+    [[nodiscard]] std::size_t getIterationAllocations() const {
+        return this->iteration_allocations;
     }
+#endif
 
     /**
      * @brief Function that implements the SID (Survey Inspired Decimation) function.
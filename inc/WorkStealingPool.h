@@ -0,0 +1,73 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+using std::vector;
+
+/**
+ * @brief Thread pool that runs a batch of independent jobs. Each worker has its own queue of jobs and, when it is
+ * empty, it steals jobs from the queues of the other workers, so the workers stay busy even if the jobs have very
+ * different costs.
+ */
+class WorkStealingPool {
+
+private:
+
+    /** Number of workers (the thread that calls Run is one of them). */
+    unsigned int n_threads;
+    /** Jobs of each worker. The owner takes them from the front and the thieves from the back. */
+    vector<std::deque<std::size_t>> queues;
+    /** Mutex of each queue. */
+    vector<std::mutex> mutexes;
+
+    /**
+     * @brief Take the next job of a worker. If its queue is empty, a job is stolen from another worker.
+     * @param worker: Index of the worker.
+     * @param job: Variable where the index of the job will be stored.
+     * @return False if every queue is empty.
+     */
+    bool NextJob(unsigned int worker, std::size_t &job);
+
+    /**
+     * @brief Loop of a worker: run jobs until every queue is empty.
+     * @param worker: Index of the worker.
+     * @param run: Function that runs a job.
+     */
+    void Work(unsigned int worker, const std::function<void(std::size_t)> &run);
+
+public:
+
+    /**
+     * @brief Constructor for WorkStealingPool.
+     * @param n_threads: Number of workers. Defaults to the number of hardware threads.
+     */
+    explicit WorkStealingPool(unsigned int n_threads = std::thread::hardware_concurrency());
+
+    /**
+     * @brief Getter for the number of workers.
+     * @return Number of workers of the pool. If the output of this function is discarded, the compiler will raise a
+     * warning.
+     */
+    [[nodiscard]] unsigned int getNThreads() const {
+        return this->n_threads;
+    }
+
+    /**
+     * @brief Run a batch of jobs and wait until all of them have finished. Each worker starts with a contiguous range
+     * of jobs. The jobs must be independent, they can run in any order and in any thread.
+     * @param n_jobs: Number of jobs. The jobs are identified by their index in [0, n_jobs).
+     * @param run: Function that runs the job with the given index.
+     */
+    void Run(std::size_t n_jobs, const std::function<void(std::size_t)> &run);
+};
+
+#endif //WORK_STEALING_POOL_H
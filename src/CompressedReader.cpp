@@ -0,0 +1,176 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#include "CompressedReader.h"
+#include <cstdlib>
+
+int CompressedReader::DetectCompression(const char *magic) {
+    auto bytes = reinterpret_cast<const unsigned char *>(magic);
+    if (bytes[0] == 0x1f && bytes[1] == 0x8b) {
+        return COMPRESSION_GZIP;
+    }
+    if (bytes[0] == 0xfd && bytes[1] == '7' && bytes[2] == 'z' && bytes[3] == 'X' && bytes[4] == 'Z' && bytes[5] == 0) {
+        return COMPRESSION_XZ;
+    }
+    if (bytes[0] == 0x28 && bytes[1] == 0xb5 && bytes[2] == 0x2f && bytes[3] == 0xfd) {
+        return COMPRESSION_ZSTD;
+    }
+    return COMPRESSION_NONE;
+}
+
+CompressedReader::CompressedReader(const std::string &path) : input(path, std::ios::binary),
+                                                              input_buffer(COMPRESSED_BLOCK_SIZE) {
+    char magic[COMPRESSION_MAGIC_SIZE] = {};
+    if (!this->input.is_open()) {
+        std::cerr << "File not found" << std::endl;
+        exit(-1);
+    }
+    this->input.read(magic, COMPRESSION_MAGIC_SIZE);
+    this->input.clear();
+    this->input.seekg(0);
+    this->format = DetectCompression(magic);
+
+    bool supported = false;
+    switch (this->format) {
+#ifdef SP_WITH_ZLIB
+        case COMPRESSION_GZIP:
+            // 16 + MAX_WBITS selects the gzip wrapper.
+            supported = inflateInit2(&this->zlib_stream, 16 + MAX_WBITS) == Z_OK;
+            break;
+#endif
+#ifdef SP_WITH_LZMA
+        case COMPRESSION_XZ:
+            supported = lzma_stream_decoder(&this->lzma_state, UINT64_MAX, LZMA_CONCATENATED) == LZMA_OK;
+            break;
+#endif
+#ifdef SP_WITH_ZSTD
+        case COMPRESSION_ZSTD:
+            this->zstd_stream = ZSTD_createDStream();
+            supported = this->zstd_stream != nullptr && !ZSTD_isError(ZSTD_initDStream(this->zstd_stream));
+            break;
+#endif
+        default:
+            break;
+    }
+    if (!supported) {
+        std::cerr << "The compression format of " << path << " is not supported" << std::endl;
+        exit(-1);
+    }
+}
+
+CompressedReader::~CompressedReader() {
+#ifdef SP_WITH_ZLIB
+    if (this->format == COMPRESSION_GZIP) {
+        inflateEnd(&this->zlib_stream);
+    }
+#endif
+#ifdef SP_WITH_LZMA
+    if (this->format == COMPRESSION_XZ) {
+        lzma_end(&this->lzma_state);
+    }
+#endif
+#ifdef SP_WITH_ZSTD
+    if (this->format == COMPRESSION_ZSTD) {
+        ZSTD_freeDStream(this->zstd_stream);
+    }
+#endif
+}
+
+std::size_t CompressedReader::FillInput() {
+    if (this->input_finished) {
+        return 0;
+    }
+    this->input.read(this->input_buffer.data(), this->input_buffer.size());
+    std::size_t read = this->input.gcount();
+    this->input_finished = read == 0;
+    return read;
+}
+
+std::size_t CompressedReader::Read(char *buffer, std::size_t size) {
+    std::size_t written = 0, read;
+    bool valid = true;
+
+    switch (this->format) {
+#ifdef SP_WITH_ZLIB
+        case COMPRESSION_GZIP: {
+            z_stream &stream = this->zlib_stream;
+            stream.next_out = reinterpret_cast<Bytef *>(buffer);
+            stream.avail_out = size;
+            while (stream.avail_out > 0) {
+                if (stream.avail_in == 0) {
+                    if ((read = this->FillInput()) == 0) {
+                        break;
+                    }
+                    stream.next_in = reinterpret_cast<Bytef *>(this->input_buffer.data());
+                    stream.avail_in = read;
+                }
+                this->stream_finished = false;
+                int status = inflate(&stream, Z_NO_FLUSH);
+                if (status == Z_STREAM_END) {
+                    // A gzip file can have several members.
+                    this->stream_finished = true;
+                    inflateReset(&stream);
+                } else if (status != Z_OK && status != Z_BUF_ERROR) {
+                    valid = false;
+                    break;
+                }
+            }
+            written = size - stream.avail_out;
+            break;
+        }
+#endif
+#ifdef SP_WITH_LZMA
+        case COMPRESSION_XZ: {
+            lzma_stream &stream = this->lzma_state;
+            stream.next_out = reinterpret_cast<uint8_t *>(buffer);
+            stream.avail_out = size;
+            while (stream.avail_out > 0 && !this->stream_finished) {
+                if (stream.avail_in == 0 && (read = this->FillInput()) > 0) {
+                    stream.next_in = reinterpret_cast<const uint8_t *>(this->input_buffer.data());
+                    stream.avail_in = read;
+                }
+                lzma_ret status = lzma_code(&stream, this->input_finished ? LZMA_FINISH : LZMA_RUN);
+                if (status == LZMA_STREAM_END) {
+                    this->stream_finished = true;
+                } else if (status != LZMA_OK) {
+                    valid = false;
+                    break;
+                }
+            }
+            written = size - stream.avail_out;
+            break;
+        }
+#endif
+#ifdef SP_WITH_ZSTD
+        case COMPRESSION_ZSTD: {
+            ZSTD_outBuffer output{buffer, size, 0};
+            while (output.pos < output.size) {
+                if (this->zstd_input.pos == this->zstd_input.size) {
+                    if ((read = this->FillInput()) == 0) {
+                        break;
+                    }
+                    this->zstd_input = {this->input_buffer.data(), read, 0};
+                }
+                // The result is 0 when a frame has been completely decoded and flushed.
+                std::size_t status = ZSTD_decompressStream(this->zstd_stream, &output, &this->zstd_input);
+                if (ZSTD_isError(status)) {
+                    valid = false;
+                    break;
+                }
+                this->stream_finished = status == 0;
+            }
+            written = output.pos;
+            break;
+        }
+#endif
+        default:
+            break;
+    }
+    // The file can't end in the middle of a compressed stream.
+    if (!valid || (written < size && !this->stream_finished)) {
+        std::cerr << "The compressed file is corrupted" << std::endl;
+        exit(-1);
+    }
+    return written;
+}
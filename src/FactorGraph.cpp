@@ -3,6 +3,22 @@
 //
 
 #include "FactorGraph.h"
+#include "CompressedReader.h"
+#include <cstdint>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef SP_COUNT_ALLOCATIONS
+std::atomic<std::size_t> AllocationCount{0};
+#endif
 
 std::ostream &operator << (std::ostream &out, const clause &clause) {
     for (auto i : clause) {
@@ -53,283 +69,863 @@ uvector genIndexVector(unsigned int N) {
 FactorGraph::FactorGraph(const std::string &path, int seed) {
     int n_clauses = 0, n_variables = 0;
     this->seed = seed;
-    ReadDIMACS(path, n_clauses, n_variables);
+    char magic[COMPRESSION_MAGIC_SIZE] = {};
+    std::ifstream(path, std::ios::binary).read(magic, COMPRESSION_MAGIC_SIZE);
+    bool surveys = false;
+    if (std::strncmp(magic, FG_BINARY_MAGIC, 4) == 0) {
+        surveys = ReadBinary(path, n_clauses, n_variables);
+    } else if (CompressedReader::DetectCompression(magic) != COMPRESSION_NONE) {
+        ReadCompressedDIMACS(path, n_clauses, n_variables);
+    } else {
+        ReadDIMACS(path, n_clauses, n_variables);
+    }
     this->NumberClauses = n_clauses;
     this->NumberVariables = n_variables;
-    ChangeWeights();
+    if (!surveys) {
+        ChangeWeights();
+    }
 }
 
-void FactorGraph::getUnitVars(std::unordered_map<unsigned int, bool> &unit_vars) const {
-    unsigned int variable;
-    bool variable_assignment;
-    for (int i = 0; i < this->NumberClauses; i++) {
-        variable = 0;
-        int pos_size = this->PositiveVariablesOfClause[i].size(), neg_size = this->NegativeVariablesOfClause[i].size();
-        if (pos_size + neg_size == 1) {
-            if (pos_size == 1) {
-                variable = this->PositiveVariablesOfClause[i][0];
-                variable_assignment = true;
-            } else {
-                variable = this->NegativeVariablesOfClause[i][0];
-                variable_assignment = false;
-            }
-        }
-        if (variable != 0 ) {
-            if (unit_vars.find(variable) == unit_vars.end()) {
-                unit_vars.insert(std::pair<unsigned int, bool> (variable, variable_assignment));
+FactorGraph::FactorGraph(unsigned int n_variables, double alpha, unsigned int k, int seed) {
+    auto n_clauses = static_cast<unsigned int>(std::lround(alpha * n_variables));
+    unsigned int n_blocks = (n_clauses + RANDOM_BLOCK_SIZE - 1) / RANDOM_BLOCK_SIZE;
+    if (k == 0 || k > n_variables || alpha < 0.0) {
+        std::cerr << "Invalid parameters of the random formula" << std::endl;
+        exit(-1);
+    }
+    this->seed = seed;
+    this->NumberVariables = static_cast<int>(n_variables);
+    this->Edges.resize(std::size_t(n_clauses) * k);
+    this->ClauseOffsets.resize(n_clauses + 1);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int b = 0; b < static_cast<int>(n_blocks); b++) {
+        std::seed_seq seq{seed, b};
+        std::mt19937 generator(seq); // Random engine generator of the block.
+        std::uniform_int_distribution<int> variables(1, static_cast<int>(n_variables));
+        std::bernoulli_distribution negated(0.5);
+        unsigned int last = std::min<unsigned int>(n_clauses, (b + 1) * RANDOM_BLOCK_SIZE);
+        for (unsigned int c = b * RANDOM_BLOCK_SIZE; c < last; c++) {
+            Edge *clause_edges = this->Edges.data() + std::size_t(c) * k;
+            this->ClauseOffsets[c] = c * k;
+            for (unsigned int i = 0; i < k; i++) {
+                int variable;
+                // The variables of a clause are different.
+                do {
+                    variable = variables(generator);
+                } while (std::any_of(clause_edges, clause_edges + i,
+                                     [variable](const Edge &edge) { return abs(edge.literal) == variable; }));
+                // The survey is initialized in ChangeWeights.
+                clause_edges[i] = {negated(generator) ? -variable : variable, c, 0, 0.0};
             }
         }
     }
+    this->ClauseOffsets[n_clauses] = n_clauses * k;
+    this->PartitionClauses();
+    this->BuildLiteralAdjacency();
+    this->ChangeWeights();
 }
 
 unsigned int FactorGraph::getIndexOfVariable(unsigned int search_clause, int variable) const {
-    bool connection_type;
-    unsigned int index = this->Connection(search_clause, abs(variable), connection_type);
-    /* Get the index of variable in search_clause. In the clauses (and weights), first appear the positive variables and
-     * then appear the negative, so in order to get the index: See if the connection is negative. If it is
-     * negative adding de number of positive variables in the clause we get the index. */
-    if (index == -1) {
-        exit(1);
+    /* Get the index of variable in search_clause. The index is the position of the edge among the live edges of the
+     * clause, which RemoveLiteral reorders (the positive variables only appear first before the decimation). */
+    View<Edge> edges = this->getEdgesOfClause(search_clause);
+    for (unsigned int index = 0; index < edges.size(); index++) {
+        if (abs(edges[index].literal) == abs(variable)) {
+            return index;
+        }
     }
-    index += connection_type ? 0 : this->getPositiveVariablesOfClause(search_clause).size();
-
-    return index;
+    exit(1);
 }
 
 void FactorGraph::setEdgeW(unsigned int search_clause, unsigned int position, double value) {
-    if (search_clause < this->NumberClauses && position < this->NumberVariables) {
-        this->EdgeWeights[search_clause][position] = value;
+    if (search_clause < this->getNTotalClauses() && position < this->ClauseSizes[search_clause]) {
+        this->Edges.Detach()[this->getClauseOffset(search_clause) + position].survey = value;
     } else {
         exit(1);
     }
 }
 
+wmatrix FactorGraph::getMatrix() const {
+    wmatrix matrix(this->NumberClauses);
+    for (int i = 0; i < this->NumberClauses; i++) {
+        matrix[i].reserve(this->ClauseSizes[this->ActiveClauses[i]]);
+        for (const Edge &edge : this->getEdgesOfClause(this->ActiveClauses[i])) {
+            matrix[i].push_back(edge.survey);
+        }
+    }
+    return matrix;
+}
+
+uvector FactorGraph::getPositiveVariablesOfClause(unsigned int search_clause) const {
+    uvector variables;
+    for (const Edge &edge : this->getEdgesOfClause(search_clause)) {
+        if (edge.literal > 0) {
+            variables.push_back(edge.literal);
+        }
+    }
+    return variables;
+}
+
+uvector FactorGraph::getNegativeVariablesOfClause(unsigned int search_clause) const {
+    uvector variables;
+    for (const Edge &edge : this->getEdgesOfClause(search_clause)) {
+        if (edge.literal < 0) {
+            variables.push_back(-edge.literal);
+        }
+    }
+    return variables;
+}
+
 double FactorGraph::getEdgeW(unsigned int search_clause, unsigned int position) const {
-    if (search_clause < this->NumberClauses && position < this->NumberVariables)
-        return this->EdgeWeights[search_clause][position];
+    if (search_clause < this->getNTotalClauses() && position < this->ClauseSizes[search_clause])
+        return this->Edges[this->ClauseOffsets[search_clause] + position].survey;
     else {
         std::cerr << "Wrong index!!" << std::endl;
         exit(1);
     }
 }
 
+/**
+ * @brief Read the next literal of the clauses section of a DIMACS file. The blank characters and the comment lines are
+ * skipped.
+ * @param p: Position where the search starts. It will point after the literal.
+ * @param end: End of the buffer.
+ * @param value: int where the literal will be stored.
+ * @return 1 if a literal was read, 0 if the end of the buffer was reached and -1 if an invalid token was found.
+ */
+static int NextLiteral(const char *&p, const char *end, int &value) {
+    while (p < end) {
+        if (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r') {
+            p++;
+        } else if (*p == 'c') {
+            // Skip the comment line.
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else {
+            bool negative = *p == '-';
+            long long number = 0;
+            if (negative) {
+                p++;
+            }
+            if (p == end || *p < '0' || *p > '9') {
+                return -1;
+            }
+            while (p < end && *p >= '0' && *p <= '9') {
+                number = number * 10 + (*p - '0');
+                if (number > std::numeric_limits<int>::max()) {
+                    return -1;
+                }
+                p++;
+            }
+            value = negative ? -static_cast<int>(number) : static_cast<int>(number);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Look for the DIMACS header (p cnf n_variables n_clauses). The blank characters and the comment lines before
+ * it are skipped.
+ * @param p: Position where the search starts. It will point to the end of the header line.
+ * @param end: End of the buffer.
+ * @param n_variables: int where the number of variables will be stored.
+ * @param n_clauses: int where the number of clauses will be stored.
+ * @return 1 if the header was read, 0 if the buffer only has blank characters and comments and -1 if the header is
+ * not valid.
+ */
+static int ReadDIMACSHeader(const char *&p, const char *end, int &n_variables, int &n_clauses) {
+    while (p < end && (*p == 'c' || *p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) {
+        if (*p == 'c') {
+            while (p < end && *p != '\n') {
+                p++;
+            }
+        } else {
+            p++;
+        }
+    }
+    if (p == end) {
+        return 0;
+    }
+    bool valid = p + 1 < end && *p == 'p' && (p[1] == ' ' || p[1] == '\t');
+    if (valid) {
+        p++;
+        while (p < end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        valid = end - p > 3 && std::strncmp(p, "cnf", 3) == 0;
+        p += 3;
+    }
+    valid = valid && NextLiteral(p, end, n_variables) == 1 && NextLiteral(p, end, n_clauses) == 1 &&
+            n_variables >= 0 && n_clauses >= 0;
+    p = std::find(p, end, '\n');
+    return valid ? 1 : -1;
+}
+
+/**
+ * @brief Look for the end of the clauses section of a DIMACS file: a line that starts with '%'.
+ * @param begin: Beginning of a line of the clauses section.
+ * @param end: End of the buffer.
+ * @return Position of the '%' or end if there isn't any.
+ */
+static const char *FindClausesEnd(const char *begin, const char *end) {
+    const char *p = begin;
+    while ((p = std::find(p, end, '%')) != end && p != begin && p[-1] != '\n') {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Piece of the clauses section of a DIMACS file. Each chunk starts at the beginning of a line, so a clause can
+ * be split between several chunks but a literal can't.
+ */
+struct DIMACSChunk {
+    /** First character of the chunk. */
+    const char *begin;
+    /** End of the chunk. */
+    const char *end;
+    /** Number of literals of the chunk. In the second pass, index of the first edge of the chunk. */
+    unsigned int literals;
+    /** Number of clauses that end in the chunk. In the second pass, index of the clause of the first literal. */
+    unsigned int clauses;
+    /** Greatest variable of the chunk. */
+    int max_variable;
+    /** True if the chunk has an invalid token. */
+    bool invalid;
+};
+
 void FactorGraph::ReadDIMACS(const std::string &path, int &n_clauses, int &n_variables) {
-    std::ifstream input_file(path);
-    std::string line;
-    if (input_file.is_open()) {
-        // Clear vectors.
-        this->PositiveVariablesOfClause.clear();
-        this->NegativeVariablesOfClause.clear();
-        this->EdgeWeights.clear();
-        this->PositiveClausesOfVariable.clear();
-        this->NegativeClausesOfVariable.clear();
-
-        // Skip the comments.
-        while (getline(input_file, line) && line[0] == 'c');
-        // Split the string
-        vector<std::string> split = SplitString(line);
-
-        // Check if the first line after the comments is the DIMACS header.
-        if (!split.empty() && split[0] == "p" && split[1] == "cnf") {
-            n_variables = std::stoi(split[2]);
-            n_clauses = std::stoi(split[3]);
-            int counter = 0, actual_value, i;
-            // This are auxiliary vectors that stores the adjacency list of the actual clause
-            uvector positive_adjacency_vector, negative_adjacency_vector;
-            uvector *selected_adjacency_vector; // This pointer helps to not repeat code.
-            // This are auxiliary vectors that stores the clauses where appear the actual variable
-            umatrix negative_variables(n_variables);
-            umatrix positive_variables(n_variables);
-            umatrix *selected_variables_vector; // The same as the above pointer
-            // We start reading the clauses section of the file
-            while (getline(input_file, line) && counter < n_clauses) {
-                split = SplitString(line);
-                // We process only the line that are not comments
-                if (split[0] != "c") {
-                    i = 0;
-                    // We start processing the actual clause using the split vector
-                    while (split[i] != "0" && i < n_variables) {
-                        actual_value = std::stoi(split[i]);
-                        // If the actual value is positive we need to storage the info in the right vector
-                        selected_adjacency_vector = actual_value > 0 ? &positive_adjacency_vector :
-                                                    &negative_adjacency_vector;
-                        selected_variables_vector = actual_value > 0 ? &positive_variables :
-                                                    &negative_variables;
-                        // We save the information in the right vectors.
-                        selected_adjacency_vector->push_back(abs(actual_value));
-                        // The variables goes from one to number of variables. We transform them to store them in
-                        // a vector.
-                        (*selected_variables_vector)[abs(actual_value) - 1].push_back(counter);
-                        i++;
-                    }
-                    //It's needed to push even when empty,
-                    this->PositiveVariablesOfClause.push_back(positive_adjacency_vector);
-                    this->NegativeVariablesOfClause.push_back(negative_adjacency_vector);
+    int file = open(path.c_str(), O_RDONLY);
+    struct stat file_stat{};
+    if (file == -1 || fstat(file, &file_stat) == -1) {
+        std::cerr << "File not found" << std::endl;
+        exit(-1);
+    }
+    std::size_t size = file_stat.st_size;
+    void *map = size == 0 ? MAP_FAILED : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (map == MAP_FAILED) {
+        std::cerr << "Enter a valid DIMACS file" << std::endl;
+        exit(-1);
+    }
+    madvise(map, size, MADV_SEQUENTIAL);
+    const char *p = static_cast<const char *>(map), *end = p + size;
 
-                    if (!positive_adjacency_vector.empty()) {
-                        positive_adjacency_vector.clear();
-                    }
-                    if (!negative_adjacency_vector.empty()) {
-                        negative_adjacency_vector.clear();
-                    }
-                    counter++;
-                }
+    if (ReadDIMACSHeader(p, end, n_variables, n_clauses) != 1) {
+        std::cerr << "Enter a valid DIMACS file" << std::endl;
+        exit(-1);
+    }
+    // The clauses section ends at the end of the file or at a line that starts with '%'.
+    const char *body = p, *body_end = FindClausesEnd(body, end);
+
+    // Split the clauses section in chunks that start at the beginning of a line.
+    std::size_t n_chunks = std::max<std::size_t>(1, (body_end - body) / DIMACS_CHUNK_SIZE);
+    vector<DIMACSChunk> chunks(n_chunks);
+    for (std::size_t i = 0; i < n_chunks; i++) {
+        chunks[i].begin = i == 0 ? body : std::find(body + i * ((body_end - body) / n_chunks), body_end, '\n');
+        chunks[i].end = body_end;
+        if (i > 0) {
+            chunks[i - 1].end = chunks[i].begin;
+        }
+    }
+
+    // First pass: count the literals and the clauses of each chunk.
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::size_t i = 0; i < n_chunks; i++) {
+        DIMACSChunk &chunk = chunks[i];
+        const char *it = chunk.begin;
+        int value, status;
+        chunk.literals = chunk.clauses = 0;
+        chunk.max_variable = 0;
+        while ((status = NextLiteral(it, chunk.end, value)) == 1) {
+            if (value == 0) {
+                chunk.clauses++;
+            } else {
+                chunk.literals++;
+                chunk.max_variable = std::max(chunk.max_variable, abs(value));
             }
-            this->PositiveClausesOfVariable = positive_variables;
-            this->NegativeClausesOfVariable = negative_variables;
-        }else{
+        }
+        chunk.invalid = status == -1;
+    }
+    unsigned int n_literals = 0, n_ended = 0, count;
+    for (DIMACSChunk &chunk : chunks) {
+        if (chunk.invalid || chunk.max_variable > n_variables) {
             std::cerr << "Enter a valid DIMACS file" << std::endl;
             exit(-1);
         }
-    }else{
-        std::cerr << "File not found" << std::endl;
+        count = chunk.literals;
+        chunk.literals = n_literals;
+        n_literals += count;
+        count = chunk.clauses;
+        chunk.clauses = n_ended;
+        n_ended += count;
+    }
+
+    // Second pass: each chunk fills its edges and the offsets of the clauses that end in it. The clause of a literal is
+    // the number of clauses that have ended before it, so the clauses that span several chunks don't need any fix.
+    this->Edges.resize(n_literals);
+    this->ClauseOffsets.assign(n_ended + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (std::size_t i = 0; i < n_chunks; i++) {
+        const char *it = chunks[i].begin;
+        unsigned int edge = chunks[i].literals, search_clause = chunks[i].clauses;
+        int value;
+        while (NextLiteral(it, chunks[i].end, value) == 1) {
+            if (value == 0) {
+                this->ClauseOffsets[++search_clause] = edge;
+            } else {
+                // The survey is initialized in ChangeWeights.
+                this->Edges[edge++] = {value, search_clause, 0, 0.0};
+            }
+        }
+    }
+    munmap(map, size);
+    // The last clause can end without a 0.
+    if (n_literals > this->ClauseOffsets.back()) {
+        this->ClauseOffsets.push_back(n_literals);
+    }
+
+    n_clauses = static_cast<int>(this->ClauseOffsets.size()) - 1;
+    this->PartitionClauses();
+    this->NumberVariables = n_variables;
+    this->BuildLiteralAdjacency();
+}
+
+void FactorGraph::ReadCompressedDIMACS(const std::string &path, int &n_clauses, int &n_variables) {
+    CompressedReader reader(path);
+    vector<char> buffer(DIMACS_STREAM_BUFFER_SIZE);
+    std::size_t filled = 0, read;
+    int status, value, max_variable = 0;
+    bool header = false, finished = false;
+
+    this->ClauseOffsets.assign(1, 0);
+    this->Edges.clear();
+    while (!finished) {
+        // The buffer only grows if a line doesn't fit in it.
+        if (filled == buffer.size()) {
+            buffer.resize(2 * buffer.size());
+        }
+        read = reader.Read(buffer.data() + filled, buffer.size() - filled);
+        finished = read == 0;
+        filled += read;
+        // Only the complete lines are parsed, the last one is kept for the next block.
+        const char *p = buffer.data(), *end = p + filled;
+        if (!finished) {
+            while (end > p && end[-1] != '\n') {
+                end--;
+            }
+        }
+        const char *lines_end = end;
+        if (!header) {
+            status = ReadDIMACSHeader(p, end, n_variables, n_clauses);
+            if (status == -1) {
+                std::cerr << "Enter a valid DIMACS file" << std::endl;
+                exit(-1);
+            }
+            header = status == 1;
+            if (header) {
+                // The edges are reserved for a 3-SAT formula, they only grow if the clauses are longer.
+                this->ClauseOffsets.reserve(n_clauses + 1);
+                this->Edges.reserve(std::size_t(n_clauses) * 3);
+            }
+        }
+        if (header) {
+            // The clauses section ends at the end of the file or at a line that starts with '%'.
+            end = FindClausesEnd(p, end);
+            finished = finished || end != lines_end;
+            // The literals are parsed straight into the edges (the survey is initialized in ChangeWeights).
+            while ((status = NextLiteral(p, end, value)) == 1) {
+                if (value == 0) {
+                    this->ClauseOffsets.push_back(this->Edges.size());
+                } else {
+                    this->Edges.push_back({value, static_cast<unsigned int>(this->ClauseOffsets.size() - 1), 0, 0.0});
+                    max_variable = std::max(max_variable, abs(value));
+                }
+            }
+            if (status == -1) {
+                std::cerr << "Enter a valid DIMACS file" << std::endl;
+                exit(-1);
+            }
+        }
+        filled = buffer.data() + filled - lines_end;
+        std::memmove(buffer.data(), lines_end, filled);
+    }
+    if (!header || max_variable > n_variables) {
+        std::cerr << "Enter a valid DIMACS file" << std::endl;
         exit(-1);
     }
-    input_file.close();
+    // The last clause can end without a 0.
+    if (this->Edges.size() > this->ClauseOffsets.back()) {
+        this->ClauseOffsets.push_back(this->Edges.size());
+    }
+
+    n_clauses = static_cast<int>(this->ClauseOffsets.size()) - 1;
+    this->PartitionClauses();
+    this->NumberVariables = n_variables;
+    this->BuildLiteralAdjacency();
 }
 
-int FactorGraph::Connection(unsigned int search_clause, unsigned int variable, bool &positive) const {
-    auto it = std::find(this->PositiveVariablesOfClause[search_clause].cbegin(),
-                        this->PositiveVariablesOfClause[search_clause].cend(), variable);
-    auto pos = -1;
-    // If the variable was founded, we have to find the index
-    if (this->PositiveVariablesOfClause[search_clause].cend() != it) {
-        // The complexity of this function is constant if the iterators are random access iterators
-        pos = std::distance(this->PositiveVariablesOfClause[search_clause].cbegin(), it);
-        positive = true;
-    } else {
-        it = std::find(this->NegativeVariablesOfClause[search_clause].cbegin(),
-                       this->NegativeVariablesOfClause[search_clause].cend(), variable);
-        if (this->NegativeVariablesOfClause[search_clause].cend() != it) {
-            // The complexity of this function is constant if the iterators are random access iterators
-            pos = std::distance(this->NegativeVariablesOfClause[search_clause].cbegin(), it);
-            positive = false;
+void FactorGraph::PartitionClauses() {
+    Edge *edges = this->Edges.Detach().data();
+    // Inside each clause the positive variables must appear before the negative ones.
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for (int c = 0; c < static_cast<int>(this->ClauseOffsets.size()) - 1; c++) {
+        auto first = edges + this->ClauseOffsets[c];
+        auto last = edges + this->ClauseOffsets[c + 1];
+        auto positive = [](const Edge &edge) { return edge.literal > 0; };
+        if (!std::is_partitioned(first, last, positive)) {
+            std::stable_partition(first, last, positive);
         }
     }
-    return pos;
 }
 
-void FactorGraph::ChangeWeights() {
-    if (!this->EdgeWeights.empty())
-        this->EdgeWeights.clear();
+void FactorGraph::BuildLiteralAdjacency() {
+    this->NumberClauses = static_cast<int>(this->ClauseOffsets.size()) - 1;
+    unsigned int n_slots = 2 * this->NumberVariables, n_edges = this->Edges.size(), offset, count;
+    int n_blocks = 1;
+#ifdef _OPENMP
+    n_blocks = std::max(1, std::min(omp_get_max_threads(), static_cast<int>(n_edges / ADJACENCY_BLOCK_SIZE)));
+#endif
+    // First pass: count the occurrences of each literal in each block of edges.
+    umatrix block_offsets(n_blocks, uvector(n_slots, 0));
+    #pragma omp parallel for num_threads(n_blocks) schedule(static, 1)
+    for (int b = 0; b < n_blocks; b++) {
+        unsigned int last = b == n_blocks - 1 ? n_edges : n_edges / n_blocks * (b + 1);
+        for (unsigned int e = n_edges / n_blocks * b; e < last; e++) {
+            block_offsets[b][LiteralSlot(this->Edges[e].literal)]++;
+        }
+    }
+    // Inside each literal the occurrences of a block go after the ones of the previous blocks.
+    this->LiteralOffsets.assign(n_slots + 1, 0);
+    for (unsigned int slot = 0; slot < n_slots; slot++) {
+        offset = this->LiteralOffsets[slot];
+        for (int b = 0; b < n_blocks; b++) {
+            count = block_offsets[b][slot];
+            block_offsets[b][slot] = offset;
+            offset += count;
+        }
+        this->LiteralOffsets[slot + 1] = offset;
+    }
+    // Second pass: fill the clauses of each literal and link each edge with its occurrence. The edges are grouped by
+    // clause, so the clauses of each literal are stored in increasing order.
+    this->LiteralClauses.resize(n_edges);
+    this->LiteralEdges.resize(n_edges);
+    // The arrays are detached once, the threads write through the pointers.
+    Edge *edges = this->Edges.Detach().data();
+    unsigned int *literal_clauses = this->LiteralClauses.data(), *literal_edges = this->LiteralEdges.data();
+    #pragma omp parallel for num_threads(n_blocks) schedule(static, 1)
+    for (int b = 0; b < n_blocks; b++) {
+        uvector &next = block_offsets[b];
+        unsigned int last = b == n_blocks - 1 ? n_edges : n_edges / n_blocks * (b + 1);
+        for (unsigned int e = n_edges / n_blocks * b; e < last; e++) {
+            Edge &edge = edges[e];
+            edge.occurrence = next[LiteralSlot(edge.literal)]++;
+            literal_clauses[edge.occurrence] = edge.clause;
+            literal_edges[edge.occurrence] = e;
+        }
+    }
+    this->ResetDecimation();
+}
 
-    std::mt19937 generator(this->seed); // Random engine generator.
-    std::uniform_real_distribution<double> distribution(0, 1); //Distribution for the random generator.
-    // Reserve memory
-    this->EdgeWeights.resize(this->NumberClauses);
-    clause actual_clause;
-    for(int i = 0; i < this->NumberClauses; i++) {
-        actual_clause = this->Clause(i);
-        for (int j = 0; j < actual_clause.size(); j++) {
-            this->EdgeWeights[i].push_back(distribution(generator));
-        }
-    }
-}
-
-void FactorGraph::UnitPropagation() {
-    std::unordered_map<unsigned int, bool> unit_vars;
-
-    this->getUnitVars(unit_vars);
-    auto it = unit_vars.begin();
-
-    do {
-        while (it != unit_vars.end()) {
-            this->PartialAssignment(it->first - 1, it->second);
-            unit_vars.erase(it->first);
-            it = unit_vars.begin();
-        }
-        this->getUnitVars(unit_vars);
-        it = unit_vars.begin();
-    } while (!unit_vars.empty());
-}
-
-void FactorGraph::ApplyNewClauses(const vector<vector<int>> &deleted, const vector<bool> &satisfied) {
-    if (this->NumberClauses != 0) {
-        unsigned int del = 0, actual_clause;
-        uvector *selected_clauses, *selected_variables;
-        clause cl;
-        for (int clause = 0; clause < this->NumberClauses; clause++) {
-            actual_clause = clause - del;
-            // If the clause is not satisfied, remove the variables assigned.
-            if (!satisfied[clause]) {
-                for (int variable : deleted[clause]) {
-                    // Selection of the positive vectors.
-                    selected_clauses = variable > 0 ? &this->PositiveVariablesOfClause[actual_clause] :
-                                       &this->NegativeVariablesOfClause[actual_clause];
-                    // Find the variable to delete in the correct clause.
-                    auto it = std::find(selected_clauses->begin(), selected_clauses->end(), abs(variable));
-                    // Calculate the position of the variable in the clause in order to delete it from EdgeWeights.
-                    unsigned int diff = std::distance(selected_clauses->begin(), it) +
-                                        (variable > 0 ? 0 : this->PositiveVariablesOfClause[actual_clause].size());
-                    selected_clauses->erase(it);
-                    // We delete the weight of the edge.
-                    this->EdgeWeights[actual_clause].erase(this->EdgeWeights[actual_clause].begin() + diff);
-                }
-                // If the clause if satisfied, remove it.
-            } else {
-                this->PositiveVariablesOfClause.erase(this->PositiveVariablesOfClause.begin() + (actual_clause));
-                this->NegativeVariablesOfClause.erase(this->NegativeVariablesOfClause.begin() + (actual_clause));
-                this->EdgeWeights.erase(EdgeWeights.begin() + actual_clause);
-                del++;
+bool FactorGraph::ReadBinary(const std::string &path, int &n_clauses, int &n_variables) {
+    int file = open(path.c_str(), O_RDONLY);
+    struct stat file_stat{};
+    if (file == -1 || fstat(file, &file_stat) == -1) {
+        std::cerr << "File not found" << std::endl;
+        exit(-1);
+    }
+    std::size_t size = file_stat.st_size, header = 4 + 5 * sizeof(uint32_t);
+    void *map = size < header ? MAP_FAILED : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (map == MAP_FAILED) {
+        std::cerr << "Enter a valid factor graph file" << std::endl;
+        exit(-1);
+    }
+    const char *data = static_cast<const char *>(map);
+    // Every check of the file leaves through this path.
+    auto invalid = [map, size]() {
+        munmap(map, size);
+        std::cerr << "Enter a valid factor graph file" << std::endl;
+        exit(-1);
+    };
+    uint32_t fields[5];
+    std::memcpy(fields, data + 4, sizeof(fields));
+    uint32_t flags = fields[1], n_edges = fields[4];
+    // Check the magic, the version and that the file has the size given by the header.
+    std::size_t offset = header + (std::size_t(fields[3]) + 1 + 2 * std::size_t(n_edges) + 2 * std::size_t(fields[2]) +
+                                   1) * sizeof(uint32_t);
+    if (flags & FG_BINARY_SURVEYS) {
+        offset += offset % sizeof(double) + n_edges * sizeof(double);
+    }
+    if (std::memcmp(data, FG_BINARY_MAGIC, 4) != 0 || fields[0] != FG_BINARY_VERSION || offset != size ||
+        fields[2] > std::numeric_limits<int>::max() / 2 || fields[3] >= std::numeric_limits<int>::max()) {
+        invalid();
+    }
+    n_variables = static_cast<int>(fields[2]);
+    n_clauses = static_cast<int>(fields[3]);
+
+    vector<int> literals(n_edges);
+    offset = header;
+    this->ClauseOffsets.resize(n_clauses + 1);
+    std::memcpy(this->ClauseOffsets.data(), data + offset, this->ClauseOffsets.size() * sizeof(uint32_t));
+    offset += this->ClauseOffsets.size() * sizeof(uint32_t);
+    std::memcpy(literals.data(), data + offset, literals.size() * sizeof(int32_t));
+    offset += literals.size() * sizeof(int32_t);
+    this->LiteralOffsets.resize(2 * n_variables + 1);
+    std::memcpy(this->LiteralOffsets.data(), data + offset, this->LiteralOffsets.size() * sizeof(uint32_t));
+    offset += this->LiteralOffsets.size() * sizeof(uint32_t);
+    this->LiteralEdges.resize(n_edges);
+    std::memcpy(this->LiteralEdges.data(), data + offset, this->LiteralEdges.size() * sizeof(uint32_t));
+    offset += this->LiteralEdges.size() * sizeof(uint32_t);
+    offset += offset % sizeof(double);
+
+    // The arrays of the file are used as indexes, so they are checked before building the edges: the offsets go from
+    // 0 to n_edges without decreasing, the literals are in the range of the variables and LiteralEdges is a
+    // permutation of the edges that lists each edge in the slot of its literal.
+    auto valid_offsets = [n_edges](const CowVector<unsigned int> &offsets) {
+        if (offsets[0] != 0 || offsets[offsets.size() - 1] != n_edges) {
+            return false;
+        }
+        for (std::size_t i = 1; i < offsets.size(); i++) {
+            if (offsets[i] < offsets[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    };
+    if (!valid_offsets(std::as_const(this->ClauseOffsets)) || !valid_offsets(std::as_const(this->LiteralOffsets))) {
+        invalid();
+    }
+    for (auto literal : literals) {
+        if (literal == 0 || literal < -n_variables || literal > n_variables) {
+            invalid();
+        }
+    }
+    vector<bool> listed(n_edges, false);
+    for (int slot = 0; slot < 2 * n_variables; slot++) {
+        for (unsigned int o = this->LiteralOffsets[slot]; o < this->LiteralOffsets[slot + 1]; o++) {
+            unsigned int e = this->LiteralEdges[o];
+            if (e >= n_edges || listed[e] || LiteralSlot(literals[e]) != static_cast<unsigned int>(slot)) {
+                invalid();
             }
+            listed[e] = true;
         }
-        // Make the Variables vectors with the new assignment.
-        for (auto &v : this->PositiveClausesOfVariable) {
-            v.clear();
+    }
+
+    // Rebuild the edges (the clause and occurrence of each edge are given by the offsets).
+    this->Edges.resize(n_edges);
+    for (int c = 0; c < n_clauses; c++) {
+        for (unsigned int e = this->ClauseOffsets[c]; e < this->ClauseOffsets[c + 1]; e++) {
+            this->Edges[e] = {literals[e], static_cast<unsigned int>(c), 0, 0.0};
         }
-        for (auto &v : this->NegativeClausesOfVariable) {
-            v.clear();
+    }
+    this->LiteralClauses.resize(n_edges);
+    for (unsigned int o = 0; o < n_edges; o++) {
+        this->Edges[this->LiteralEdges[o]].occurrence = o;
+        this->LiteralClauses[o] = this->Edges[this->LiteralEdges[o]].clause;
+    }
+    if (flags & FG_BINARY_SURVEYS) {
+        for (unsigned int e = 0; e < n_edges; e++) {
+            std::memcpy(&this->Edges[e].survey, data + offset + e * sizeof(double), sizeof(double));
+        }
+    }
+    munmap(map, size);
+
+    this->NumberClauses = n_clauses;
+    this->NumberVariables = n_variables;
+    this->ResetDecimation();
+    return flags & FG_BINARY_SURVEYS;
+}
+
+void FactorGraph::WriteBinary(const std::string &path, bool surveys) const {
+    // The decimation is undone in a copy, so every edge is live and every clause is active.
+    FactorGraph copy;
+    const FactorGraph *graph = this;
+    if (!this->Trail.empty()) {
+        copy = *this;
+        copy.Backtrack(0);
+        graph = &copy;
+    }
+    std::ofstream output(path, std::ios::binary);
+    if (!output.is_open()) {
+        std::cerr << "The file " << path << " can't be created" << std::endl;
+        exit(-1);
+    }
+    vector<int> literals(graph->Edges.size());
+    vector<double> edge_surveys(surveys ? graph->Edges.size() : 0);
+    for (unsigned int e = 0; e < graph->Edges.size(); e++) {
+        literals[e] = graph->Edges[e].literal;
+        if (surveys) {
+            edge_surveys[e] = graph->Edges[e].survey;
         }
+    }
+    uint32_t fields[5] = {FG_BINARY_VERSION, surveys ? FG_BINARY_SURVEYS : 0u,
+                          static_cast<uint32_t>(graph->NumberVariables), graph->getNTotalClauses(),
+                          static_cast<uint32_t>(graph->Edges.size())};
+    output.write(FG_BINARY_MAGIC, 4);
+    output.write(reinterpret_cast<const char *>(fields), sizeof(fields));
+    output.write(reinterpret_cast<const char *>(graph->ClauseOffsets.data()),
+                 graph->ClauseOffsets.size() * sizeof(uint32_t));
+    output.write(reinterpret_cast<const char *>(literals.data()), literals.size() * sizeof(int32_t));
+    output.write(reinterpret_cast<const char *>(graph->LiteralOffsets.data()),
+                 graph->LiteralOffsets.size() * sizeof(uint32_t));
+    output.write(reinterpret_cast<const char *>(graph->LiteralEdges.data()),
+                 graph->LiteralEdges.size() * sizeof(uint32_t));
+    if (surveys) {
+        const char padding[sizeof(double)] = {};
+        output.write(padding, output.tellp() % sizeof(double));
+        output.write(reinterpret_cast<const char *>(edge_surveys.data()), edge_surveys.size() * sizeof(double));
+    }
+    if (!output) {
+        std::cerr << "The file " << path << " can't be written" << std::endl;
+        exit(-1);
+    }
+}
+
+void FactorGraph::Detach() {
+    this->Edges.Detach();
+    this->LiteralClauses.Detach();
+    this->LiteralEdges.Detach();
+    this->ClauseSizes.Detach();
+    this->LiteralSizes.Detach();
+    this->ActiveClauses.Detach();
+    this->ClausePositions.Detach();
+    this->Assignment.Detach();
+    this->Trail.Detach();
+    this->UnitQueue.Detach();
+}
 
-        for (int clause = 0; clause < this->PositiveVariablesOfClause.size(); clause++) {
-            cl = this->Clause(clause);
-            for (auto var : cl) {
-                selected_variables =
-                        var > 0 ? &this->PositiveClausesOfVariable[var - 1] : &this->NegativeClausesOfVariable[abs(var) - 1];
-                selected_variables->push_back(clause);
+void FactorGraph::ResetDecimation() {
+    // Every edge, occurrence and clause is live.
+    this->ClauseSizes.resize(this->NumberClauses);
+    this->EmptyClauses = 0;
+    this->UnitQueue.clear();
+    for (int c = 0; c < this->NumberClauses; c++) {
+        this->ClauseSizes[c] = this->ClauseOffsets[c + 1] - this->ClauseOffsets[c];
+        this->EmptyClauses += this->ClauseSizes[c] == 0 ? 1 : 0;
+        // The unit clauses of the formula are the first ones to propagate.
+        if (this->ClauseSizes[c] == 1) {
+            this->UnitQueue.push_back(c);
+        }
+    }
+    // The width is fixed if every clause has the size of the first one and its variables are different.
+    this->ClauseWidth = this->NumberClauses > 0 ? this->ClauseSizes[0] : 0;
+    for (int c = 0; c < this->NumberClauses && this->ClauseWidth > 0; c++) {
+        View<Edge> edges = this->getEdgesOfClause(c);
+        if (this->ClauseSizes[c] != this->ClauseWidth) {
+            this->ClauseWidth = 0;
+        }
+        for (unsigned int i = 0; i < this->ClauseWidth; i++) {
+            for (unsigned int j = i + 1; j < this->ClauseWidth; j++) {
+                if (abs(edges[i].literal) == abs(edges[j].literal)) {
+                    this->ClauseWidth = 0;
+                }
             }
         }
-        this->NumberClauses = this->PositiveVariablesOfClause.size();
     }
+    this->LiteralSizes.resize(2 * this->NumberVariables);
+    for (int slot = 0; slot < 2 * this->NumberVariables; slot++) {
+        this->LiteralSizes[slot] = this->LiteralOffsets[slot + 1] - this->LiteralOffsets[slot];
+    }
+    this->ActiveClauses = genIndexVector(this->NumberClauses);
+    this->ClausePositions = genIndexVector(this->NumberClauses);
+    this->Assignment.assign(this->NumberVariables, 0);
+    this->Trail.clear();
 }
 
-void FactorGraph::PartialAssignment(unsigned int variable_index, bool assignation) {
-    int variable = static_cast<int>(variable_index) + 1;
-    vector<bool> satisfied_clauses(this->NumberClauses, false);
-    // This matrix will save the deleted variables from each clause.
-    vector<vector<int>> deleted_variables_from_clauses;
-    deleted_variables_from_clauses.resize(this->NumberClauses);
-    // Positive variables.
-    for (auto search_clause : this->PositiveClausesOfVariable[variable_index]) {
-        // If the variable appears as positive and the assignment is false, the variable is deleted from the clause.
-        if (!assignation) {
-            deleted_variables_from_clauses[search_clause].push_back(variable);
-        // If the variable appears as positive and the assignment is true, the clause is satisfied
-        } else {
-            satisfied_clauses[search_clause] = true;
+void FactorGraph::SwapEdges(unsigned int e1, unsigned int e2) {
+    if (e1 != e2) {
+        std::swap(this->Edges[e1], this->Edges[e2]);
+        this->LiteralEdges[this->Edges[e1].occurrence] = e1;
+        this->LiteralEdges[this->Edges[e2].occurrence] = e2;
+    }
+}
+
+void FactorGraph::SwapOccurrences(unsigned int o1, unsigned int o2) {
+    if (o1 != o2) {
+        std::swap(this->LiteralClauses[o1], this->LiteralClauses[o2]);
+        std::swap(this->LiteralEdges[o1], this->LiteralEdges[o2]);
+        this->Edges[this->LiteralEdges[o1]].occurrence = o1;
+        this->Edges[this->LiteralEdges[o2]].occurrence = o2;
+    }
+}
+
+void FactorGraph::RemoveOccurrence(unsigned int edge) {
+    unsigned int slot = LiteralSlot(this->Edges[edge].literal);
+    // The occurrence is swapped with the last live occurrence of the literal.
+    this->SwapOccurrences(this->Edges[edge].occurrence, this->getLiteralOffset(slot) + this->LiteralSizes[slot] - 1);
+    this->LiteralSizes[slot]--;
+}
+
+void FactorGraph::RestoreOccurrence(unsigned int edge) {
+    unsigned int slot = LiteralSlot(this->Edges[edge].literal);
+    // The occurrence is swapped with the first removed occurrence of the literal.
+    this->SwapOccurrences(this->Edges[edge].occurrence, this->getLiteralOffset(slot) + this->LiteralSizes[slot]);
+    this->LiteralSizes[slot]++;
+}
+
+void FactorGraph::SatisfyClause(unsigned int search_clause) {
+    unsigned int position = this->ClausePositions[search_clause];
+    unsigned int last = this->ActiveClauses[this->NumberClauses - 1];
+    // The satisfied clause doesn't appear in the literals of its variables.
+    for (unsigned int e = this->getClauseOffset(search_clause);
+         e < this->getClauseOffset(search_clause) + this->ClauseSizes[search_clause]; e++) {
+        this->RemoveOccurrence(e);
+    }
+    // Swap the clause with the last active clause and remove it from the active clauses.
+    std::swap(this->ActiveClauses[position], this->ActiveClauses[this->NumberClauses - 1]);
+    this->ClausePositions[last] = position;
+    this->ClausePositions[search_clause] = this->NumberClauses - 1;
+    this->NumberClauses--;
+    this->Trail.push_back({TRAIL_SATISFIED, search_clause});
+}
+
+void FactorGraph::RemoveLiteral(unsigned int edge) {
+    unsigned int search_clause = this->Edges[edge].clause;
+    this->RemoveOccurrence(edge);
+    // The edge is swapped with the last live edge of the clause.
+    this->SwapEdges(edge, this->getClauseOffset(search_clause) + this->ClauseSizes[search_clause] - 1);
+    this->ClauseSizes[search_clause]--;
+    if (this->ClauseSizes[search_clause] == 0) {
+        this->EmptyClauses++;
+    } else if (this->ClauseSizes[search_clause] == 1) {
+        this->UnitQueue.push_back(search_clause);
+    }
+    this->Trail.push_back({TRAIL_REMOVED, search_clause});
+}
+
+void FactorGraph::Backtrack(std::size_t level) {
+    unsigned int first, position, swapped;
+    // The views taken below must point to the arrays of this graph, not to the ones shared with a snapshot.
+    this->Detach();
+    if (this->Trail.size() > level) {
+        this->BacktrackEpoch++;
+    }
+    while (this->Trail.size() > level) {
+        TrailEntry entry = this->Trail.back();
+        this->Trail.pop_back();
+        switch (entry.type) {
+            case TRAIL_ASSIGNMENT:
+                this->Assignment[entry.id] = 0;
+                break;
+            case TRAIL_SATISFIED:
+                // The clause is the first one after the active clauses, because the later changes have been undone.
+                position = this->ClausePositions[entry.id];
+                swapped = this->ActiveClauses[this->NumberClauses];
+                std::swap(this->ActiveClauses[position], this->ActiveClauses[this->NumberClauses]);
+                this->ClausePositions[swapped] = position;
+                this->ClausePositions[entry.id] = this->NumberClauses;
+                this->NumberClauses++;
+                // Restore the occurrences in the reverse order.
+                first = this->getClauseOffset(entry.id);
+                for (unsigned int e = first + this->ClauseSizes[entry.id]; e > first; e--) {
+                    this->RestoreOccurrence(e - 1);
+                }
+                // A restored unit clause has to be propagated again.
+                if (this->ClauseSizes[entry.id] == 1) {
+                    this->UnitQueue.push_back(entry.id);
+                }
+                break;
+            case TRAIL_REMOVED:
+                // The removed edge is the first one after the live edges of the clause.
+                if (this->ClauseSizes[entry.id] == 0) {
+                    this->EmptyClauses--;
+                }
+                this->ClauseSizes[entry.id]++;
+                this->RestoreOccurrence(this->getClauseOffset(entry.id) + this->ClauseSizes[entry.id] - 1);
+                if (this->ClauseSizes[entry.id] == 1) {
+                    this->UnitQueue.push_back(entry.id);
+                }
+                break;
+            default:
+                break;
         }
     }
-    // Negative variables.
-    for (auto search_clause : this->NegativeClausesOfVariable[variable_index]) {
-        // If the variable appears as negative and the assignment is true, the variable is deleted from the clause.
-        if (assignation) {
-            deleted_variables_from_clauses[search_clause].push_back(-variable);
-        // If the variable appears as negative and the assignment is false, the clause is satisfied.
-        } else {
-            satisfied_clauses[search_clause] = true;
+}
+
+void FactorGraph::ChangeWeights() {
+    std::mt19937 generator(this->seed); // Random engine generator.
+    std::uniform_real_distribution<double> distribution(0, 1); //Distribution for the random generator.
+    for (Edge &edge : this->Edges.Detach()) {
+        edge.survey = distribution(generator);
+    }
+}
+
+bool FactorGraph::UnitPropagation() {
+    METRICS_TIMER(this->metrics, PHASE_UNIT_PROPAGATION);
+    unsigned int search_clause;
+    int literal;
+    this->Detach();
+    while (this->EmptyClauses == 0 && !this->UnitQueue.empty()) {
+        search_clause = this->UnitQueue.back();
+        this->UnitQueue.pop_back();
+        // Skip the stale entries: the clause has been satisfied or it has lost its last literal.
+        if (this->ClausePositions[search_clause] >= this->NumberClauses || this->ClauseSizes[search_clause] != 1) {
+            continue;
+        }
+        literal = this->Edges[this->getClauseOffset(search_clause)].literal;
+        // The assignment can make new unit clauses, which are pushed in the queue by RemoveLiteral.
+        if (this->AssignVariable(abs(literal) - 1, literal > 0)) {
+            METRICS_ADD(this->metrics, propagated_units, 1);
+        }
+    }
+    return this->EmptyClauses == 0;
+}
+
+void FactorGraph::PartialAssignment(unsigned int variable_index, bool assignation) {
+    METRICS_TIMER(this->metrics, PHASE_PARTIAL_ASSIGNMENT);
+    this->Detach();
+    if (this->AssignVariable(variable_index, assignation)) {
+        METRICS_ADD(this->metrics, decimated_variables, 1);
+    }
+}
+
+bool FactorGraph::PartialAssignment(const vector<int> &literals) {
+    METRICS_TIMER(this->metrics, PHASE_PARTIAL_ASSIGNMENT);
+    this->Detach();
+    for (int literal : literals) {
+        if (this->EmptyClauses > 0) {
+            break;
+        }
+        if (this->AssignVariable(abs(literal) - 1, literal > 0)) {
+            METRICS_ADD(this->metrics, decimated_variables, 1);
         }
     }
-    this->ApplyNewClauses(deleted_variables_from_clauses, satisfied_clauses);
+    return this->EmptyClauses == 0;
+}
+
+bool FactorGraph::AssignVariable(unsigned int variable_index, bool assignation) {
+    int variable = static_cast<int>(variable_index) + 1;
+    unsigned int true_slot, false_slot;
+    if (this->Assignment[variable_index] != 0) {
+        return false;
+    }
+    this->Assignment[variable_index] = assignation ? 1 : -1;
+    this->Trail.push_back({TRAIL_ASSIGNMENT, variable_index});
+    true_slot = LiteralSlot(assignation ? variable : -variable);
+    false_slot = LiteralSlot(assignation ? -variable : variable);
+    // The clauses where the literal is true are satisfied. Satisfying a clause removes its occurrence from the literal,
+    // so the last live occurrence is taken until there is none.
+    while (this->LiteralSizes[true_slot] > 0) {
+        unsigned int last = this->getLiteralOffset(true_slot) + this->LiteralSizes[true_slot] - 1;
+        this->SatisfyClause(this->LiteralClauses[last]);
+    }
+    // The literal is deleted from the clauses where it is false.
+    while (this->LiteralSizes[false_slot] > 0) {
+        unsigned int last = this->getLiteralOffset(false_slot) + this->LiteralSizes[false_slot] - 1;
+        this->RemoveLiteral(this->LiteralEdges[last]);
+    }
+    return true;
 }
 
 clause FactorGraph::Clause(unsigned int search_clause) const {
     clause ret_clause;
-    if (search_clause < this->NumberClauses) {
-        ret_clause.reserve(this->PositiveVariablesOfClause[search_clause].size() + this->NegativeVariablesOfClause[search_clause].size());
-        for (auto it : this->PositiveVariablesOfClause[search_clause])
-            ret_clause.push_back(it);
-        for (auto it : this->NegativeVariablesOfClause[search_clause])
-                ret_clause.push_back(-it);
+    if (search_clause < this->getNTotalClauses()) {
+        ret_clause.reserve(this->ClauseSizes[search_clause]);
+        for (const Edge &edge : this->getEdgesOfClause(search_clause))
+            ret_clause.push_back(edge.literal);
     }
     return ret_clause;
 }
@@ -338,11 +934,11 @@ uvector FactorGraph::getClausesOfVariable(int variable) const {
     uvector ret_clause;
     unsigned int variable_index = variable > 0 ? variable - 1 : abs(variable) - 1;
         if (variable_index < this->NumberVariables) {
-        ret_clause.reserve(this->PositiveClausesOfVariable[variable_index].size() + this->NegativeClausesOfVariable[variable_index].size());
-
-        ret_clause = this->PositiveClausesOfVariable[variable_index];
-        for (auto it : this->NegativeClausesOfVariable[variable_index])
-            ret_clause.push_back(it);
+        View<unsigned int> positive = this->getPositiveClausesOfVariable(variable);
+        View<unsigned int> negative = this->getNegativeClausesOfVariable(variable);
+        ret_clause.reserve(positive.size() + negative.size());
+        ret_clause.assign(positive.begin(), positive.end());
+        ret_clause.insert(ret_clause.end(), negative.begin(), negative.end());
 
     } else {
         exit(1);
@@ -361,132 +957,178 @@ bool FactorGraph::SatisfiesC(const vector<bool> &assignment, const clause &searc
     return false;
 }
 
-bool FactorGraph::SatisfiesF(const vector<bool> &assign, vector<bool> &sat, const uvector &indexes) const {
+void FactorGraph::InitWalkSAT(WalkSATState &state, std::mt19937 &gen) const {
+
+    std::uniform_int_distribution<int> bdist(0, 1); //Distribution for the random boolean generator.
+    unsigned int n_clauses = this->getNTotalClauses();
 
-    bool sat_clause;
-    bool satisfied_formula = true;
-    for (auto search_clause : indexes) {
-        sat_clause = this->SatisfiesC(assign, this->Clause(search_clause));
-        if (!sat_clause) {
-            satisfied_formula = false;
+    state.assignment.resize(this->NumberVariables);
+    for (unsigned int i = 0; i < this->NumberVariables; i++) {
+        state.assignment[i] = static_cast<char>(bdist(gen));
+        if (this->Assignment[i] != 0) {
+            state.assignment[i] = this->Assignment[i] > 0;
         }
-        sat[search_clause] = sat_clause;
     }
-    return satisfied_formula;
-}
-
-uvector FactorGraph::getBreakCount(const vector<bool> &sat_clauses, const clause &s_clause, const vector<bool> &assign,
-                                   unsigned int &min_index, int &freebie) const {
-
-    uvector break_count(s_clause.size(), 0);
-    uvector sat_count(s_clause.size(), 0);
-    vector<bool> copy(assign);
-    clause c;
-
-    unsigned int variable_index;
-    unsigned int n_sat_clauses = 0;
 
-    unsigned int min = this->NumberClauses;
-    freebie = -1;
+    state.true_count.assign(n_clauses, 0);
+    state.true_xor.assign(n_clauses, 0);
+    state.break_count.assign(this->NumberVariables, 0);
+    state.unsatisfied.clear();
+    state.unsatisfied_positions.assign(n_clauses, -1);
 
-    for (int i = 0; i < s_clause.size(); i++) {
-        n_sat_clauses = 0;
-        variable_index = s_clause[i] > 0 ? s_clause[i] - 1 : abs(s_clause[i]) - 1;
-        // Get the clauses where each variable appears.
-        for (auto clause_index : this->getClausesOfVariable(s_clause[i])) {
-            // If the clause is satisfied, we calculate the break count of that variable
-            if (sat_clauses[clause_index]) {
-                // flip the variable
-                copy[variable_index] = !copy[variable_index];
-                // check the assignment
-                if (!this->SatisfiesC(copy, this->Clause(clause_index))) {
-                    break_count[i]++;
-                } else {
-                    sat_count[i]++;
-                }
-                // Restore the assignment
-                copy[variable_index] = !copy[variable_index];
-                n_sat_clauses++;
+    for (auto search_clause : this->getActiveClauses()) {
+        for (const Edge &edge : this->getEdgesOfClause(search_clause)) {
+            unsigned int variable = abs(edge.literal) - 1;
+            if (static_cast<bool>(state.assignment[variable]) == (edge.literal > 0)) {
+                state.true_count[search_clause]++;
+                state.true_xor[search_clause] ^= variable;
             }
         }
+        if (state.true_count[search_clause] == 0) {
+            state.unsatisfied_positions[search_clause] = state.unsatisfied.size();
+            state.unsatisfied.push_back(search_clause);
+        } else if (state.true_count[search_clause] == 1) {
+            state.break_count[state.true_xor[search_clause]]++;
+        }
+    }
+}
+
+void FactorGraph::FlipVariable(WalkSATState &state, unsigned int variable) const {
 
-        if (break_count[i] < min) {
-            min = break_count[i];
-            min_index = i;
+    int variable_id = static_cast<int>(variable) + 1;
+    // The literal of the variable that is true before the flip becomes false and the opposite one becomes true.
+    bool value = state.assignment[variable];
+    View<unsigned int> true_clauses = value ? this->getPositiveClausesOfVariable(variable_id) :
+                                              this->getNegativeClausesOfVariable(variable_id);
+    View<unsigned int> false_clauses = value ? this->getNegativeClausesOfVariable(variable_id) :
+                                               this->getPositiveClausesOfVariable(variable_id);
+    state.assignment[variable] = !value;
+
+    for (auto search_clause : true_clauses) {
+        state.true_xor[search_clause] ^= variable;
+        if (--state.true_count[search_clause] == 0) {
+            // The variable was the only true literal of the clause.
+            state.break_count[variable]--;
+            state.unsatisfied_positions[search_clause] = state.unsatisfied.size();
+            state.unsatisfied.push_back(search_clause);
+        } else if (state.true_count[search_clause] == 1) {
+            state.break_count[state.true_xor[search_clause]]++;
         }
+    }
 
-        if (sat_count[i] == n_sat_clauses) {
-            freebie = i;
+    for (auto search_clause : false_clauses) {
+        if (state.true_count[search_clause] == 0) {
+            // Remove the clause from the unsatisfied clauses by swapping it with the last one.
+            int position = state.unsatisfied_positions[search_clause];
+            unsigned int last = state.unsatisfied.back();
+            state.unsatisfied[position] = last;
+            state.unsatisfied_positions[last] = position;
+            state.unsatisfied.pop_back();
+            state.unsatisfied_positions[search_clause] = -1;
+            state.break_count[variable]++;
+        } else if (state.true_count[search_clause] == 1) {
+            // The clause had a single true literal, now it has two.
+            state.break_count[state.true_xor[search_clause]]--;
         }
+        state.true_xor[search_clause] ^= variable;
+        state.true_count[search_clause]++;
     }
-    return break_count;
 }
 
-vector<bool>
-FactorGraph::WalkSAT(unsigned int max_tries, unsigned int max_flips, double noise, const vector<int>& fixed_variables) const {
-
-    unsigned int min_index, v;
-    bool sat;
-    int freebie = -1;
+bool FactorGraph::WalkSATTry(WalkSATState &state, std::mt19937 &gen, unsigned int max_flips, double noise,
+                             const std::atomic<unsigned int> &best_try, unsigned int try_index) const {
 
-    vector<bool> assignment(this->NumberVariables);
-    vector<bool> sat_clauses(this->NumberClauses, false);
-    uvector not_satisfied_clauses, indexes(this->NumberClauses);
-
-    std::mt19937 gen(this->seed * 2); // Random engine generator.
-    std::uniform_int_distribution<int> bdist(0, 1); //Distribution for the random boolean generator.
     std::uniform_real_distribution<double> double_dist(0, 1); //Distribution for the random real generator.
+    unsigned int min, min_index, v, break_count;
+    int freebie;
 
-    for (int i = 0; i < max_tries; i++) {
-        std::generate(assignment.begin(), assignment.end(), [&bdist, &gen]() {return static_cast<bool>(bdist(gen));});
-        indexes.clear();
-        indexes = genIndexVector(this->NumberClauses);
-        // Update the sat_clauses vector of the clauses that where changed previously.
-        for (int flips = 0; flips < max_flips; flips++) {
-            this->SatisfiesF(assignment, sat_clauses, indexes);
-            // Get the clauses state of the clauses with the given assignment.
-            not_satisfied_clauses.clear();
-            sat = true;
-            // Check if the assignment satisfies the formula. Save the not satisfied clauses in an auxiliary vector.
-            for (int clause = 0; clause < sat_clauses.size(); clause++) {
-                if (!sat_clauses[clause]) {
-                    sat = false;
-                    not_satisfied_clauses.push_back(clause);
-                }
+    this->InitWalkSAT(state, gen);
+    for (unsigned int flips = 0; flips < max_flips; flips++) {
+        // If the formula is satisfied, the try has finished.
+        if (state.unsatisfied.empty()) {
+            return true;
+        }
+        // Stop if a previous try has already succeeded.
+        if ((flips & WALKSAT_CANCEL_CHECK) == 0 && best_try.load(std::memory_order_relaxed) < try_index) {
+            return false;
+        }
+
+        std::uniform_int_distribution<int> int_dist(0, state.unsatisfied.size() - 1);
+        // We get a random not satisfied clause
+        View<Edge> C = this->getEdgesOfClause(state.unsatisfied[int_dist(gen)]);
+        // Look for the variable with lower break count and for a freebie move.
+        min = this->NumberClauses;
+        min_index = 0;
+        freebie = -1;
+        for (unsigned int i = 0; i < C.size(); i++) {
+            break_count = state.break_count[abs(C[i].literal) - 1];
+            if (break_count < min) {
+                min = break_count;
+                min_index = i;
             }
-            // If the formula is satisfied, return the assignment.
-            if (sat) {
-                return assignment;
+            if (break_count == 0) {
+                freebie = i;
             }
+        }
+        // Check the freebie move.
+        if (freebie != -1) {
+            v = freebie;
+        } else if (double_dist(gen) > noise) {
+            std::uniform_int_distribution<unsigned int> dis(0, C.size() - 1);
+            v = dis(gen);
+        // We choose tha variable with lower break count
+        } else {
+            v = min_index;
+        }
+        this->FlipVariable(state, abs(C[v].literal) - 1);
+        METRICS_ADD(state, flips, 1);
+    }
+    return state.unsatisfied.empty();
+}
 
-            std::uniform_int_distribution<int> int_dist(0, not_satisfied_clauses.size() - 1);
-            // We get a random not satisfied clause
-            clause C = this->Clause(not_satisfied_clauses[int_dist(gen)]);
-            uvector count = this->getBreakCount(sat_clauses, C, assignment, min_index, freebie);
-            // Check the freebie move.
-            if (freebie != -1) {
-                v = freebie;
-            } else if (double_dist(gen) > noise) {
-                std::uniform_int_distribution<unsigned int> dis(0, C.size() - 1);
-                v = dis(gen);
-            // We choose tha variable with lower break count
-            } else {
-                v = min_index;
+vector<bool>
+FactorGraph::WalkSAT(unsigned int max_tries, unsigned int max_flips, double noise, const vector<int>& fixed_variables,
+                     int n_threads, const std::atomic<bool> *cancel) const {
+
+    METRICS_TIMER(this->metrics, PHASE_WALKSAT);
+    vector<bool> assignment;
+    std::atomic<unsigned int> next_try{0};
+    std::atomic<unsigned int> best_try{max_tries};
+
+    #pragma omp parallel num_threads(n_threads < 1 ? 1 : n_threads)
+    {
+        WalkSATState state;
+        unsigned int try_index;
+        // The tries are taken in order, so every try before the first one that succeeds is completed.
+        while ((try_index = next_try++) < best_try.load() &&
+               (cancel == nullptr || !cancel->load(std::memory_order_relaxed))) {
+            std::seed_seq seq{this->seed * 2, static_cast<int>(try_index)};
+            std::mt19937 gen(seq); // Random engine generator of the try.
+            METRICS_ADD(state, tries, 1);
+            if (this->WalkSATTry(state, gen, max_flips, noise, best_try, try_index)) {
+                #pragma omp critical(walksat_result)
+                {
+                    if (try_index < best_try.load()) {
+                        best_try = try_index;
+                        assignment.assign(state.assignment.begin(), state.assignment.end());
+                    }
+                }
             }
-            // Get the index of the variable that will be flipped
-            int index = C[v] > 0 ? C[v] - 1 : abs(C[v]) - 1;
-            assignment[index] = !assignment[index];
-            // Check if the new assignment satisfies the clauses where the selected variable appears.
-            // We update the variables that are going to be searched
-            indexes = this->getClausesOfVariable(C[v]);
         }
+#ifdef SP_METRICS
+        #pragma omp critical(walksat_result)
+        {
+            this->metrics.flips += state.flips;
+            this->metrics.restarts += state.tries;
+        }
+#endif
     }
-    return vector<bool>();
+    return assignment;
 }
 
 std::ostream &operator << (std::ostream &out, const FactorGraph &graph) {
     out << "p cnf " << graph.NumberVariables << " " << graph.NumberClauses << std::endl;
-    for (int i = 0; i < graph.NumberClauses; i++) {
+    for (auto i : graph.getActiveClauses()) {
         for (int it : graph.Clause(i)) {
             out << it << " ";
         }
@@ -501,7 +1143,7 @@ bool FactorGraph::CheckAssignment(const vector<bool> &assignment) const {
         return false;
     }
 
-    for (int clause = 0; clause < this->NumberClauses; clause++) {
+    for (auto clause : this->getActiveClauses()) {
         if (!this->SatisfiesC(assignment, this->Clause(clause))){
             return false;
         }
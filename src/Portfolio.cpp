@@ -0,0 +1,61 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#include "Portfolio.h"
+
+void Portfolio::AddAttempts(unsigned int k, const PortfolioAttempt &base) {
+    const double noise_shifts[3] = {0.0, -0.05, 0.05};
+    for (unsigned int i = 0; i < k; i++) {
+        PortfolioAttempt attempt = base;
+        attempt.seed = base.seed + static_cast<int>(i);
+        attempt.fraction = base.fraction / (1 << (i % 3));
+        attempt.noise = base.noise + noise_shifts[(i / 3) % 3];
+        attempt.damping = (i / 9) % 2 == 0 ? base.damping : std::min(DAMPING_MAX, (1 + base.damping) / 2);
+        this->attempts.push_back(attempt);
+    }
+}
+
+int Portfolio::Run(vector<bool> &assignment) {
+    std::atomic<bool> cancel{false};
+    std::mutex winner_mutex;
+    assignment.clear();
+    this->winner = -1;
+    this->results.assign(this->attempts.size(), PORTFOLIO_CANCELLED);
+    this->pool.Run(this->attempts.size(), [this, &cancel, &winner_mutex, &assignment](std::size_t i) {
+        const PortfolioAttempt &attempt = this->attempts[i];
+        vector<bool> solution;
+        if (cancel.load()) {
+            return;
+        }
+        // Each attempt starts from its own random surveys.
+        SurveyPropagation<> solver(this->graph, attempt.seed);
+        solver.RandomizeSurveys();
+        solver.setDamping(attempt.damping, attempt.adaptive_damping);
+        solver.setWalkSATNoise(attempt.noise);
+        solver.setCancelFlag(&cancel);
+        this->results[i] = attempt.fraction > 0.0 ? solver.SIDF(solution, attempt.fraction) :
+                                                    solver.SID(solution, attempt.sid_iters);
+        // A false positive doesn't stop the other attempts.
+        if (this->results[i] == SAT && this->graph.CheckAssignment(solution)) {
+            std::lock_guard<std::mutex> lock(winner_mutex);
+            if (this->winner == -1) {
+                this->winner = static_cast<int>(i);
+                assignment = std::move(solution);
+                cancel = true;
+            }
+        }
+    });
+    if (this->winner != -1) {
+        return SAT;
+    }
+    // No attempt has been cancelled, so the results of every attempt are combined.
+    if (std::find(this->results.begin(), this->results.end(), PROB_UNSAT) != this->results.end()) {
+        return PROB_UNSAT;
+    }
+    if (!this->results.empty() &&
+        std::all_of(this->results.begin(), this->results.end(), [](int result) { return result == CONTRADICTION; })) {
+        return CONTRADICTION;
+    }
+    return SP_UNCONVERGED;
+}
@@ -4,120 +4,794 @@
 
 #include "SurveyPropagation.h"
 
-void SurveyPropagation::Update(unsigned int search_clause, int variable) {
-    // Preconditions: Clause and variable must be in the range and there has to be a connection.
-    if (search_clause > this->AssociatedGraph->getNClauses() || variable > this->AssociatedGraph->getNVariables()) {
-        return;
+template <typename Real>
+double SurveyPropagation<Real>::Update(unsigned int edge) {
+    // Preconditions: The edge must be in the range.
+    if (edge >= this->AssociatedGraph->getNEdges()) {
+        return 0.0;
     }
+    return this->SaveSurvey(edge, this->ComputeSurvey(edge));
+}
 
-    clause va;
-    int index = -1;
-    uvector va_u, va_s;
-    double survey = 1.0, weight;
-    double product_u, product_s, pi_u, pi_s, pi_0;
+template <typename Real>
+Real SurveyPropagation<Real>::ComputeSurvey(unsigned int edge) const {
+    unsigned int search_clause = this->AssociatedGraph->getEdge(edge).clause;
+    unsigned int first = this->AssociatedGraph->getClauseOffset(search_clause);
+    View<Edge> va;
+    Real survey = 1.0;
 
     // Get V(search_clause)
-    va = this->AssociatedGraph->Clause(search_clause);
-    // For every variable j of va (except for the variable)
-    for (int j = 0; j < va.size(); j++) {
-        if (va[j] != variable) {
-            product_s = product_u = pi_0 = 1.0;
-            // Get the va_s (clauses where j appears with the same sign) and
-            // v_u (clauses where j appears with the opposite sign) sets.
-            if (va[j] > 0) {
-                va_s = this->AssociatedGraph->getPositiveClausesOfVariable(va[j]);
-                va_u = this->AssociatedGraph->getNegativeClausesOfVariable(va[j]);
+    va = this->AssociatedGraph->getEdgesOfClause(search_clause);
+    // For every variable j of va (except for the variable of the edge)
+    for (unsigned int j = 0; j < va.size(); j++) {
+        if (first + j != edge) {
+            survey *= this->CavityFactor(first + j, va[j].literal);
+            // Check the lower bound.
+            survey = survey < this->lower_bound ? 0.0 : survey;
+        }
+    }
+    return survey;
+}
+
+template <typename Real>
+Real SurveyPropagation<Real>::CavityFactor(unsigned int edge, int literal) const {
+    View<unsigned int> va_u, va_s;
+    Real product_u, product_s;
+    // Get the edges of va_s (clauses where the variable appears with the same sign) and v_u (clauses where the
+    // variable appears with the opposite sign) sets.
+    if (literal > 0) {
+        va_s = this->AssociatedGraph->getPositiveEdgesOfVariable(literal);
+        va_u = this->AssociatedGraph->getNegativeEdgesOfVariable(literal);
+    } else {
+        va_s = this->AssociatedGraph->getNegativeEdgesOfVariable(literal);
+        va_u = this->AssociatedGraph->getPositiveEdgesOfVariable(literal);
+    }
+    // Calculation of product u and product s. The edge itself is skipped.
+    product_u = CavityProduct(this->surveys.data(), va_u.begin(), va_u.size(), NO_EDGE);
+    product_s = CavityProduct(this->surveys.data(), va_s.begin(), va_s.size(), edge);
+    return this->SurveyFactor(product_u, product_s, product_u * product_s);
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::SaveSurvey(unsigned int edge, Real survey) {
+    Real delta = std::abs(survey - this->surveys[edge]);
+    // Save the new survey, damped.
+    this->surveys[edge] = this->current_damping * this->surveys[edge] + (1 - this->current_damping) * survey;
+    return delta;
+}
+
+template <typename Real>
+Real SurveyPropagation<Real>::SurveyFactor(Real product_u, Real product_s, Real pi_0) const {
+    Real pi_u, pi_s;
+    product_u = product_u < this->lower_bound ? 0.0 : product_u;
+    product_s = product_s < this->lower_bound ? 0.0 : product_s;
+    // Calculate pis.s
+    pi_u = (1.0 - product_u) * product_s;
+    pi_s = (1.0 - product_s) * product_u;
+    // Check if the calculated pi is lower than the bound.
+    pi_s = pi_s < this->lower_bound ? 0.0 : pi_s;
+    pi_u = pi_u < this->lower_bound ? 0.0 : pi_u;
+    pi_0 = pi_0 < this->lower_bound ? 0.0 : pi_0;
+    // Check the division by zero.
+    if ((pi_u + pi_s + pi_0) == 0) {
+        return 0.0;
+    }
+    return pi_u / (pi_u + pi_s + pi_0);
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::InitProducts() {
+    unsigned int first;
+    Real weight;
+    this->literal_products.assign(2 * this->AssociatedGraph->getNVariables(), 1.0);
+    this->literal_zeros.assign(2 * this->AssociatedGraph->getNVariables(), 0);
+    // Only the live edges of the active clauses are used.
+    for (auto c : this->AssociatedGraph->getActiveClauses()) {
+        first = this->AssociatedGraph->getClauseOffset(c);
+        View<Edge> edges = this->AssociatedGraph->getEdgesOfClause(c);
+        for (unsigned int j = 0; j < edges.size(); j++) {
+            weight = 1 - this->surveys[first + j];
+            // The zero factors are counted apart, so they can be divided out later.
+            if (weight == 0.0) {
+                this->literal_zeros[FactorGraph::LiteralSlot(edges[j].literal)]++;
             } else {
-                va_s = this->AssociatedGraph->getNegativeClausesOfVariable(va[j]);
-                va_u = this->AssociatedGraph->getPositiveClausesOfVariable(va[j]);
+                this->literal_products[FactorGraph::LiteralSlot(edges[j].literal)] *= weight;
             }
+        }
+    }
+}
 
-            // Calculation of product u
-            for (auto b : va_u) {
-                weight = 1.0 - this->AssociatedGraph->getEdgeW(b, this->AssociatedGraph->getIndexOfVariable(b, va[j]));
-                product_u *= weight;
-                pi_0 *= weight;
+template <typename Real>
+void SurveyPropagation<Real>::LoadSurveys() {
+    this->surveys.resize(this->AssociatedGraph->getNEdges());
+    for (unsigned int e = 0; e < this->surveys.size(); e++) {
+        this->surveys[e] = static_cast<Real>(this->AssociatedGraph->getSurvey(e));
+    }
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::StoreSurveys() {
+    this->AssociatedGraph->setSurveys(this->surveys);
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::UpdateCached(unsigned int edge) {
+    // Preconditions: The edge must be in the range.
+    if (edge >= this->AssociatedGraph->getNEdges()) {
+        return 0.0;
+    }
+    return this->SaveSurveyCached(edge, this->ComputeSurveyCached(edge));
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::SaveSurveyCached(unsigned int edge, Real survey) {
+    unsigned int slot = FactorGraph::LiteralSlot(this->AssociatedGraph->getEdge(edge).literal);
+    Real weight, delta = std::abs(survey - this->surveys[edge]);
+    survey = this->current_damping * this->surveys[edge] + (1 - this->current_damping) * survey;
+    // Replace the old factor of the edge by the new one in the product of its literal.
+    weight = 1 - this->surveys[edge];
+    if (weight == 0.0) {
+        this->literal_zeros[slot]--;
+    } else {
+        this->literal_products[slot] /= weight;
+    }
+    weight = 1 - survey;
+    if (weight == 0.0) {
+        this->literal_zeros[slot]++;
+    } else {
+        this->literal_products[slot] *= weight;
+    }
+    // Save the new survey.
+    this->surveys[edge] = survey;
+    return delta;
+}
+
+template <typename Real>
+Real SurveyPropagation<Real>::ComputeSurveyCached(unsigned int edge) const {
+    const Edge &updated = this->AssociatedGraph->getEdge(edge);
+    unsigned int first = this->AssociatedGraph->getClauseOffset(updated.clause);
+    View<Edge> va = this->AssociatedGraph->getEdgesOfClause(updated.clause);
+    Real survey = 1.0;
+
+    // For every variable j of va (except for the variable of the edge)
+    for (unsigned int j = 0; j < va.size(); j++) {
+        if (first + j != edge) {
+            survey *= this->CavityFactorCached(first + j, va[j].literal);
+            // Check the lower bound.
+            survey = survey < this->lower_bound ? 0.0 : survey;
+        }
+    }
+    return survey;
+}
+
+template <typename Real>
+Real SurveyPropagation<Real>::CavityFactorCached(unsigned int edge, int literal) const {
+    unsigned int slot_s = FactorGraph::LiteralSlot(literal), slot_u = FactorGraph::LiteralSlot(-literal);
+    Real weight, product_u, product_s;
+    // The opposite sign product is used as it is.
+    product_u = this->literal_zeros[slot_u] > 0 ? 0.0 : this->literal_products[slot_u];
+    // The factor of the edge is divided out from the same sign product.
+    weight = 1 - this->surveys[edge];
+    if (weight == 0.0) {
+        product_s = this->literal_zeros[slot_s] > 1 ? 0.0 : this->literal_products[slot_s];
+    } else {
+        product_s = this->literal_zeros[slot_s] > 0 ? 0.0 : this->literal_products[slot_s] / weight;
+    }
+    return this->SurveyFactor(product_u, product_s, product_u * product_s);
+}
+
+template <typename Real>
+template <unsigned int K>
+void SurveyPropagation<Real>::ComputeClause(unsigned int clause, Real *clause_surveys) const {
+    unsigned int first = this->AssociatedGraph->getClauseOffset(clause);
+    const Edge *edges = this->AssociatedGraph->getEdgesOfClause(clause).begin();
+    Real factors[K], survey;
+    for (unsigned int j = 0; j < K; j++) {
+        factors[j] = this->cached_products ? this->CavityFactorCached(first + j, edges[j].literal) :
+                                             this->CavityFactor(first + j, edges[j].literal);
+    }
+    // The factors are in [0, 1], so the product only falls and checking the lower bound at the end gives the same
+    // survey as checking it after each factor.
+    for (unsigned int i = 0; i < K; i++) {
+        survey = 1.0;
+        for (unsigned int j = 0; j < K; j++) {
+            if (j != i) {
+                survey *= factors[j];
             }
-            // Calculation of product s
-            for (auto b : va_s) {
-                if (b != search_clause) {
-                    weight = 1.0 - this->AssociatedGraph->getEdgeW(b, this->AssociatedGraph->getIndexOfVariable(b, va[j]));
-                    product_s *= weight;
-                    pi_0 *= weight;
+        }
+        clause_surveys[i] = survey < this->lower_bound ? 0.0 : survey;
+    }
+}
+
+template <typename Real>
+template <unsigned int K>
+double SurveyPropagation<Real>::UpdateClause(unsigned int clause, bool &trivial) {
+    unsigned int first = this->AssociatedGraph->getClauseOffset(clause);
+    Real clause_surveys[K];
+    double max_delta = 0.0;
+    this->ComputeClause<K>(clause, clause_surveys);
+    for (unsigned int j = 0; j < K; j++) {
+        max_delta = std::max(max_delta, this->cached_products ? this->SaveSurveyCached(first + j, clause_surveys[j]) :
+                                                                this->SaveSurvey(first + j, clause_surveys[j]));
+        trivial = trivial && this->surveys[first + j] == 0.0;
+    }
+    return max_delta;
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::ComputeFixedClause(unsigned int clause, Real *clause_surveys) const {
+    switch (this->clause_width) {
+        case 3:
+            this->ComputeClause<3>(clause, clause_surveys);
+            break;
+        case 4:
+            this->ComputeClause<4>(clause, clause_surveys);
+            break;
+        default:
+            this->ComputeClause<5>(clause, clause_surveys);
+    }
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::UpdateFixedClause(unsigned int clause, bool &trivial) {
+    switch (this->clause_width) {
+        case 3:
+            return this->UpdateClause<3>(clause, trivial);
+        case 4:
+            return this->UpdateClause<4>(clause, trivial);
+        default:
+            return this->UpdateClause<5>(clause, trivial);
+    }
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::ColourClauses() {
+    unsigned int colour;
+    // Colour used by each clause and last clause that has forbidden each colour.
+    vector<int> clause_colours(this->AssociatedGraph->getNTotalClauses(), -1), forbidden;
+    this->colour_classes.clear();
+    for (auto c : this->AssociatedGraph->getActiveClauses()) {
+        // The colours of the coloured clauses that share a variable with c can't be used.
+        for (const Edge &edge : this->AssociatedGraph->getEdgesOfClause(c)) {
+            for (auto b : this->AssociatedGraph->getClausesOfVariable(edge.literal)) {
+                if (clause_colours[b] != -1) {
+                    forbidden[clause_colours[b]] = c;
                 }
             }
-            product_u = product_u < this->lower_bound ? 0.0 : product_u;
-            product_s = product_s < this->lower_bound ? 0.0 : product_s;
-            // Calculate pis.s
-            pi_0 = pi_0 < this->lower_bound ? 0.0 : pi_0;
-            pi_u = (1.0 - product_u) * product_s;
-            pi_s = (1.0 - product_s) * product_u;
-            // Check if the calculated pi is lower than the bound.
-            pi_s = pi_s < this->lower_bound ? 0.0 : pi_s;
-            pi_u = pi_u < this->lower_bound ? 0.0 : pi_u;
-            pi_0 = pi_0 < this->lower_bound ? 0.0 : pi_0;
-            // Check the division by zero.
-            if ((pi_u + pi_s + pi_0) == 0) {
-                survey = 0.0;
-            } else {
-                // Calculate survey using calculated pi.
-                survey *= (pi_u / (pi_u + pi_s + pi_0));
-                // Check the lower bound.
-                survey = survey < this->lower_bound ? 0.0 : survey;
+        }
+        // Greedy colouring: take the first colour that is not forbidden.
+        colour = 0;
+        while (colour < forbidden.size() && forbidden[colour] == c) {
+            colour++;
+        }
+        if (colour == forbidden.size()) {
+            forbidden.push_back(-1);
+            this->colour_classes.emplace_back();
+        }
+        clause_colours[c] = colour;
+        this->colour_classes[colour].push_back(c);
+    }
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::SynchronousSweep(bool &trivial) {
+    View<unsigned int> clauses = this->AssociatedGraph->getActiveClauses();
+    double max_delta = 0.0;
+    bool all_zero = true;
+    this->next_surveys.resize(this->AssociatedGraph->getNEdges());
+    // Every new survey is computed from the surveys of the previous sweep.
+    #pragma omp parallel for num_threads(this->threads) schedule(static)
+    for (int i = 0; i < clauses.size(); i++) {
+        unsigned int first = this->AssociatedGraph->getClauseOffset(clauses[i]);
+        unsigned int last = first + this->AssociatedGraph->getEdgesOfClause(clauses[i]).size();
+        if (this->FixedWidth(clauses[i])) {
+            this->ComputeFixedClause(clauses[i], this->next_surveys.data() + first);
+            continue;
+        }
+        for (unsigned int e = first; e < last; e++) {
+            this->next_surveys[e] = this->cached_products ? this->ComputeSurveyCached(e) : this->ComputeSurvey(e);
+        }
+    }
+    // The convergence and the triviality are checked while the new surveys are copied.
+    #pragma omp parallel for num_threads(this->threads) schedule(static) reduction(max:max_delta) reduction(&&:all_zero)
+    for (int i = 0; i < clauses.size(); i++) {
+        unsigned int first = this->AssociatedGraph->getClauseOffset(clauses[i]);
+        unsigned int last = first + this->AssociatedGraph->getEdgesOfClause(clauses[i]).size();
+        for (unsigned int e = first; e < last; e++) {
+            max_delta = std::max(max_delta, double(std::abs(this->next_surveys[e] - this->surveys[e])));
+            this->surveys[e] = this->current_damping * this->surveys[e] +
+                               (1 - this->current_damping) * this->next_surveys[e];
+            all_zero = all_zero && this->surveys[e] == 0.0;
+        }
+    }
+    trivial = all_zero;
+    return max_delta;
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::ColouredSweep(std::mt19937 &generator, bool &trivial) {
+    double max_delta = 0.0;
+    bool all_zero = true;
+    this->colour_indexes.resize(this->colour_classes.size());
+    std::iota(this->colour_indexes.begin(), this->colour_indexes.end(), 0);
+    std::shuffle(this->colour_indexes.begin(), this->colour_indexes.end(), generator);
+    for (auto colour : this->colour_indexes) {
+        const uvector &clauses = this->colour_classes[colour];
+        // The clauses of a colour don't share variables, so their updates don't read or write the same products.
+        #pragma omp parallel for num_threads(this->threads) schedule(dynamic, 64) reduction(max:max_delta) \
+                reduction(&&:all_zero)
+        for (int i = 0; i < clauses.size(); i++) {
+            unsigned int first = this->AssociatedGraph->getClauseOffset(clauses[i]);
+            unsigned int last = first + this->AssociatedGraph->getEdgesOfClause(clauses[i]).size();
+            if (this->FixedWidth(clauses[i])) {
+                max_delta = std::max(max_delta, this->UpdateFixedClause(clauses[i], all_zero));
+                continue;
+            }
+            for (unsigned int e = first; e < last; e++) {
+                max_delta = std::max(max_delta, this->cached_products ? this->UpdateCached(e) : this->Update(e));
+                all_zero = all_zero && this->surveys[e] == 0.0;
+            }
+        }
+    }
+    trivial = all_zero;
+    return max_delta;
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::ResetResiduals() {
+    this->residuals.assign(this->AssociatedGraph->getNEdges(), 0.0);
+    this->edge_buckets.assign(this->AssociatedGraph->getNEdges(), -1);
+    this->bucket_positions.resize(this->AssociatedGraph->getNEdges());
+    this->residual_buckets.resize(RESIDUAL_BUCKETS);
+    for (auto &bucket : this->residual_buckets) {
+        bucket.clear();
+    }
+    this->first_bucket = RESIDUAL_BUCKETS - 1;
+    this->queued_edges = 0;
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::QueueResidual(unsigned int edge) {
+    // The residuals are lower than 2 (the surveys are in [0, 1]), so the bucket is minus the exponent of the residual.
+    int bucket = std::min(RESIDUAL_BUCKETS - 1, std::max(0, -std::ilogb(this->residuals[edge])));
+    if (this->edge_buckets[edge] == bucket) {
+        return;
+    }
+    if (this->edge_buckets[edge] != -1) {
+        this->DequeueResidual(edge);
+    }
+    this->edge_buckets[edge] = bucket;
+    this->bucket_positions[edge] = this->residual_buckets[bucket].size();
+    this->residual_buckets[bucket].push_back(edge);
+    this->first_bucket = std::min(this->first_bucket, static_cast<unsigned int>(bucket));
+    this->queued_edges++;
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::DequeueResidual(unsigned int edge) {
+    uvector &bucket = this->residual_buckets[this->edge_buckets[edge]];
+    // The last edge of the bucket takes the position of the removed edge.
+    bucket[this->bucket_positions[edge]] = bucket.back();
+    this->bucket_positions[bucket.back()] = this->bucket_positions[edge];
+    bucket.pop_back();
+    this->edge_buckets[edge] = -1;
+    this->queued_edges--;
+}
+
+template <typename Real>
+Real SurveyPropagation<Real>::ExactResidual(unsigned int edge) const {
+    return std::abs((this->cached_products ? this->ComputeSurveyCached(edge) : this->ComputeSurvey(edge)) -
+                    this->surveys[edge]);
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::SeedResiduals(bool &trivial) {
+    unsigned int first, last;
+    double max_residual = 0.0;
+    trivial = true;
+    this->live_edges = 0;
+    for (auto c : this->AssociatedGraph->getActiveClauses()) {
+        first = this->AssociatedGraph->getClauseOffset(c);
+        last = first + this->AssociatedGraph->getEdgesOfClause(c).size();
+        for (unsigned int e = first; e < last; e++) {
+            this->residuals[e] = this->ExactResidual(e);
+            max_residual = std::max(max_residual, double(this->residuals[e]));
+            trivial = trivial && this->surveys[e] == 0.0;
+            if (this->residuals[e] > this->precision) {
+                this->QueueResidual(e);
+            }
+        }
+        this->live_edges += last - first;
+    }
+    return max_residual;
+}
+
+template <typename Real>
+Real SurveyPropagation<Real>::LiteralFactor(int literal) const {
+    View<unsigned int> edges;
+    Real product_s, product_u;
+    if (this->cached_products) {
+        product_s = this->literal_zeros[FactorGraph::LiteralSlot(literal)] > 0 ? 0.0 :
+                    this->literal_products[FactorGraph::LiteralSlot(literal)];
+        product_u = this->literal_zeros[FactorGraph::LiteralSlot(-literal)] > 0 ? 0.0 :
+                    this->literal_products[FactorGraph::LiteralSlot(-literal)];
+    } else {
+        edges = literal > 0 ? this->AssociatedGraph->getPositiveEdgesOfVariable(literal) :
+                              this->AssociatedGraph->getNegativeEdgesOfVariable(literal);
+        product_s = CavityProduct(this->surveys.data(), edges.begin(), edges.size(), NO_EDGE);
+        edges = literal > 0 ? this->AssociatedGraph->getNegativeEdgesOfVariable(literal) :
+                              this->AssociatedGraph->getPositiveEdgesOfVariable(literal);
+        product_u = CavityProduct(this->surveys.data(), edges.begin(), edges.size(), NO_EDGE);
+    }
+    return this->SurveyFactor(product_u, product_s, product_u * product_s);
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::PropagateResidual(int literal, unsigned int edge, Real before, Real after) {
+    unsigned int clause, first, last;
+    Real change;
+    if (before == after) {
+        return;
+    }
+    // The surveys of the other edges of a clause are proportional to the factor of the literal. If it was zero, they
+    // are zero and any change is considered big.
+    change = before == 0.0 ? 1.0 : std::abs(after - before) / before;
+    for (auto g : literal > 0 ? this->AssociatedGraph->getPositiveEdgesOfVariable(literal) :
+                                this->AssociatedGraph->getNegativeEdgesOfVariable(literal)) {
+        if (g == edge) {
+            continue;
+        }
+        clause = this->AssociatedGraph->getEdge(g).clause;
+        first = this->AssociatedGraph->getClauseOffset(clause);
+        last = first + this->AssociatedGraph->getEdgesOfClause(clause).size();
+        for (unsigned int f = first; f < last; f++) {
+            if (f != g) {
+                this->residuals[f] += before == 0.0 ? change : change * this->surveys[f];
+                if (this->residuals[f] > this->precision) {
+                    this->QueueResidual(f);
+                }
             }
+        }
+    }
+}
 
+template <typename Real>
+void SurveyPropagation<Real>::PropagateResiduals(std::size_t max_updates) {
+    unsigned int edge, clause;
+    int literal;
+    bool was_zero;
+    Real same_factor, opposite_factor;
+    for (std::size_t updates = 0; this->queued_edges > 0 && updates < max_updates; updates++) {
+        while (this->residual_buckets[this->first_bucket].empty()) {
+            this->first_bucket++;
+        }
+        edge = this->residual_buckets[this->first_bucket].back();
+        this->DequeueResidual(edge);
+        this->residuals[edge] = 0.0;
+        // The survey is an input of the other edges of the clauses of its variable, through the factors of its literal
+        // and the opposite literal.
+        literal = this->AssociatedGraph->getEdge(edge).literal;
+        same_factor = this->LiteralFactor(literal);
+        opposite_factor = this->LiteralFactor(-literal);
+        was_zero = this->surveys[edge] == 0.0;
+        METRICS_ADD(this->metrics, edge_updates, 1);
+        if (this->cached_products) {
+            (void) this->UpdateCached(edge);
         } else {
-            // Get the index for the setEdgeW function.
-            index = j;
+            (void) this->Update(edge);
         }
+        // The incremental mode keeps the number of non zero surveys and saves only the updated surveys in the graph.
+        if (this->warm) {
+            clause = this->AssociatedGraph->getEdge(edge).clause;
+            if (was_zero != (this->surveys[edge] == 0.0)) {
+                this->clause_nonzero[clause] += was_zero ? 1 : -1;
+                this->nonzero_surveys += was_zero ? 1 : -1;
+            }
+            this->updated_edges.push_back(edge);
+        }
+        this->PropagateResidual(literal, edge, same_factor, this->LiteralFactor(literal));
+        this->PropagateResidual(-literal, edge, opposite_factor, this->LiteralFactor(-literal));
     }
-    // Save the new survey.
-    this->AssociatedGraph->setEdgeW(search_clause, index, survey);
 }
 
-int SurveyPropagation::SP(bool &trivial) {
-    bool converged;
-    wmatrix prev_warnings;
+template <typename Real>
+double SurveyPropagation<Real>::ResidualSweep(bool &trivial) {
+    // The first call of each SP computes the residuals.
+    if (this->queued_edges == 0) {
+        return this->SeedResiduals(trivial);
+    }
+    trivial = false;
+    this->PropagateResiduals(this->live_edges);
+    // If every residual is lower than the precision, the exact residuals are checked.
+    if (this->queued_edges == 0) {
+        return this->SeedResiduals(trivial);
+    }
+    while (this->residual_buckets[this->first_bucket].empty()) {
+        this->first_bucket++;
+    }
+    return this->residuals[this->residual_buckets[this->first_bucket].back()];
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::InitWarmState() {
+    unsigned int first, last;
+    if (this->cached_products) {
+        this->InitProducts();
+    }
+    this->ResetResiduals();
+    this->clause_nonzero.assign(this->AssociatedGraph->getNTotalClauses(), 0);
+    this->nonzero_surveys = 0;
+    this->live_edges = 0;
+    for (auto c : this->AssociatedGraph->getActiveClauses()) {
+        first = this->AssociatedGraph->getClauseOffset(c);
+        last = first + this->AssociatedGraph->getEdgesOfClause(c).size();
+        this->live_edges += last - first;
+        for (unsigned int e = first; e < last; e++) {
+            this->clause_nonzero[c] += this->surveys[e] != 0.0 ? 1 : 0;
+        }
+        this->nonzero_surveys += this->clause_nonzero[c];
+    }
+    this->synced_trail = this->AssociatedGraph->getTrailSize();
+    this->synced_epoch = this->AssociatedGraph->getBacktrackEpoch();
+    this->warm = true;
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::InitLiteralProducts(int literal) {
+    unsigned int slot = FactorGraph::LiteralSlot(literal);
+    Real weight;
+    this->literal_products[slot] = 1.0;
+    this->literal_zeros[slot] = 0;
+    for (auto e : literal > 0 ? this->AssociatedGraph->getPositiveEdgesOfVariable(literal) :
+                                this->AssociatedGraph->getNegativeEdgesOfVariable(literal)) {
+        weight = 1 - this->surveys[e];
+        if (weight == 0.0) {
+            this->literal_zeros[slot]++;
+        } else {
+            this->literal_products[slot] *= weight;
+        }
+    }
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::QueueNeighbourhood(int variable) {
+    unsigned int clause, first, last;
+    for (const View<unsigned int> &edges : {this->AssociatedGraph->getPositiveEdgesOfVariable(variable),
+                                            this->AssociatedGraph->getNegativeEdgesOfVariable(variable)}) {
+        for (auto g : edges) {
+            clause = this->AssociatedGraph->getEdge(g).clause;
+            first = this->AssociatedGraph->getClauseOffset(clause);
+            last = first + this->AssociatedGraph->getEdgesOfClause(clause).size();
+            for (unsigned int f = first; f < last; f++) {
+                if (f != g) {
+                    this->residuals[f] = this->ExactResidual(f);
+                    if (this->residuals[f] > this->precision) {
+                        this->QueueResidual(f);
+                    }
+                }
+            }
+        }
+    }
+}
+
+template <typename Real>
+int SurveyPropagation<Real>::IncrementalSP(bool &trivial) {
+    unsigned int first, last;
+    View<TrailEntry> changes = this->AssociatedGraph->getTrail(this->synced_trail);
+    this->updated_edges.clear();
+    this->changed_variables.clear();
+    for (const TrailEntry &entry : changes) {
+        if (entry.type == TRAIL_ASSIGNMENT) {
+            this->changed_variables.push_back(entry.id + 1);
+            continue;
+        }
+        first = this->AssociatedGraph->getClauseOffset(entry.id);
+        last = first + this->AssociatedGraph->getEdgesOfClause(entry.id).size();
+        this->nonzero_surveys -= this->clause_nonzero[entry.id];
+        this->clause_nonzero[entry.id] = 0;
+        if (entry.type == TRAIL_SATISFIED) {
+            this->live_edges -= last - first;
+            // The clause doesn't appear in the products of its variables any more.
+            for (unsigned int e = first; e < last; e++) {
+                this->changed_variables.push_back(abs(this->AssociatedGraph->getEdge(e).literal));
+            }
+        } else {
+            this->live_edges--;
+            // Removing a literal swaps the edges of the clause, so its surveys are copied again from the graph (they
+            // were saved at the end of the last call).
+            for (unsigned int e = first; e < this->AssociatedGraph->getClauseOffset(entry.id + 1); e++) {
+                this->surveys[e] = static_cast<Real>(this->AssociatedGraph->getSurvey(e));
+            }
+            for (unsigned int e = first; e < last; e++) {
+                this->clause_nonzero[entry.id] += this->surveys[e] != 0.0 ? 1 : 0;
+            }
+            this->nonzero_surveys += this->clause_nonzero[entry.id];
+        }
+    }
+    // The products of the literals of the changed variables are computed again before the residuals use them.
+    if (this->cached_products) {
+        for (auto variable : this->changed_variables) {
+            this->InitLiteralProducts(static_cast<int>(variable));
+            this->InitLiteralProducts(-static_cast<int>(variable));
+        }
+    }
+    // The frontier: the edges of the clauses that have lost a literal and the edges that use the products of the
+    // changed variables.
+    for (const TrailEntry &entry : changes) {
+        if (entry.type == TRAIL_REMOVED && this->AssociatedGraph->isClauseActive(entry.id)) {
+            first = this->AssociatedGraph->getClauseOffset(entry.id);
+            last = first + this->AssociatedGraph->getEdgesOfClause(entry.id).size();
+            for (unsigned int e = first; e < last; e++) {
+                this->residuals[e] = this->ExactResidual(e);
+                if (this->residuals[e] > this->precision) {
+                    this->QueueResidual(e);
+                }
+            }
+        }
+    }
+    for (auto variable : this->changed_variables) {
+        this->QueueNeighbourhood(static_cast<int>(variable));
+    }
+    // The updates spread from the frontier while the residuals are higher than the precision.
+    {
+        METRICS_TIMER(this->metrics, PHASE_UPDATE);
+        METRICS_ADD(this->metrics, sweeps, 1);
+        this->PropagateResiduals(this->live_edges / INCREMENTAL_FRACTION);
+    }
+    this->AssociatedGraph->setSurveys(this->surveys, this->updated_edges);
+    this->synced_trail = this->AssociatedGraph->getTrailSize();
+    this->synced_epoch = this->AssociatedGraph->getBacktrackEpoch();
+    trivial = this->nonzero_surveys == 0;
+    if (this->queued_edges > 0) {
+        this->warm = false;
+        return SP_UNCONVERGED;
+    }
+    return SP_CONVERGED;
+}
+
+template <typename Real>
+double SurveyPropagation<Real>::SequentialSweep(std::mt19937 &generator, uvector &clauses_indexes, bool &trivial) {
+    unsigned int first;
+    double max_delta = 0.0;
+    trivial = true;
+    // Choose random clauses without repetition.
+    std::shuffle(clauses_indexes.begin(), clauses_indexes.end(), generator);
+    for (int index : clauses_indexes) {
+        // The surveys of a clause with distinct variables don't depend on each other, so their order doesn't matter.
+        if (this->FixedWidth(index)) {
+            max_delta = std::max(max_delta, this->UpdateFixedClause(index, trivial));
+            continue;
+        }
+        first = this->AssociatedGraph->getClauseOffset(index);
+        // The scratch vector only grows, so after the first clauses there are no allocations.
+        this->clause_positions.resize(this->AssociatedGraph->getEdgesOfClause(index).size());
+        std::iota(this->clause_positions.begin(), this->clause_positions.end(), 0);
+        // Choose random variable from the clause without repetition.
+        std::shuffle(this->clause_positions.begin(), this->clause_positions.end(), generator);
+        // Update every edge.
+        for (int i : this->clause_positions) {
+            max_delta = std::max(max_delta, this->cached_products ? this->UpdateCached(first + i) :
+                                            this->Update(first + i));
+            trivial = trivial && this->surveys[first + i] == 0.0;
+        }
+    }
+    return max_delta;
+}
+
+template <typename Real>
+void SurveyPropagation<Real>::TrackOscillations(double residual) {
+    int trend;
+    if (this->previous_residual >= 0.0 && residual != this->previous_residual) {
+        trend = residual > this->previous_residual ? 1 : -1;
+        // The residual of a converging SP falls, if it goes up and down the surveys are oscillating.
+        this->oscillations = this->residual_trend == -trend ? this->oscillations + 1 : 0;
+        this->residual_trend = trend;
+        if (this->oscillations == DAMPING_OSCILLATIONS) {
+            this->current_damping = std::min(Real(DAMPING_MAX), (1 + this->current_damping) / 2);
+            this->oscillations = 0;
+        }
+    }
+    this->previous_residual = residual;
+}
+
+template <typename Real>
+int SurveyPropagation<Real>::SP(bool &trivial) {
+    METRICS_TIMER(this->metrics, PHASE_SP);
+    METRICS_ADD(this->metrics, sp_calls, 1);
+    double max_delta;
     std::mt19937 generator(this->seed * 3); // Random engine generator.
     std::uniform_real_distribution<double> distribution(0, 1); //Distribution for the random generator.
-    uvector clauses_indexes = genIndexVector(this->AssociatedGraph->getNClauses()), var_indexes;
-    clause clause;
+    View<unsigned int> active = this->AssociatedGraph->getActiveClauses();
+    uvector clauses_indexes;
+
+    this->current_damping = this->damping;
+    this->previous_residual = -1.0;
+    this->residual_trend = 0;
+    this->oscillations = 0;
+    // If the graph has been backtracked, the surveys of the solver don't match it (even if new changes have grown the
+    // trail back). If the changes spread to a big part of the graph, a complete SP (that starts from the surveys
+    // updated by IncrementalSP) is cheaper.
+    if (this->incremental && this->warm && this->AssociatedGraph->getBacktrackEpoch() == this->synced_epoch &&
+        this->IncrementalSP(trivial) == SP_CONVERGED) {
+        return SP_CONVERGED;
+    }
+    this->warm = false;
+    clauses_indexes.assign(active.begin(), active.end());
+#ifdef SP_METRICS
+    // The sweeps (except the residual one) update every live edge.
+    std::size_t sweep_edges = 0;
+    for (auto c : active) {
+        sweep_edges += this->AssociatedGraph->getEdgesOfClause(c).size();
+    }
+#endif
+
+    // The sweeps work on the surveys in the precision of the solver, they are saved in the graph when SP finishes.
+    this->LoadSurveys();
+
+    // The graph could have changed since the last call, so the colouring and the residuals are made again.
+    if (this->sweep_mode == SWEEP_COLOURED) {
+        this->ColourClauses();
+    } else if (this->sweep_mode == SWEEP_RESIDUAL) {
+        this->ResetResiduals();
+    }
 
     for (int iters = 0; iters < this->n_iters; iters++) {
-        converged = true;
-        trivial = true;
-        prev_warnings = this->AssociatedGraph->getMatrix();
-        // Choose random clauses without repetition.
-        std::shuffle(clauses_indexes.begin(), clauses_indexes.end(), generator);
-        for (int index : clauses_indexes) {
-            clause = this->AssociatedGraph->Clause(index);
-            var_indexes = genIndexVector(clause.size());
-            // Choose random variable from the clause without repetition.
-            std::shuffle(var_indexes.begin(), var_indexes.end(), generator);
-            // Update every edge.
-            for (int i : var_indexes) {
-                this->Update(index, clause[i]);
+#ifdef SP_COUNT_ALLOCATIONS
+        std::size_t allocations = AllocationCount;
+#endif
+        // The cached products are recomputed in each iteration of the sweeps, so the rounding errors of the divisions
+        // don't build up. The residual sweep keeps them up to date with each update (an iteration only updates some
+        // edges), so they are only computed in the first iteration, after the surveys are loaded.
+        if (this->cached_products && (this->sweep_mode != SWEEP_RESIDUAL || iters == 0)) {
+            this->InitProducts();
+        }
+        // The sweeps track the maximum change of the surveys and if all of them are zero.
+        {
+            METRICS_TIMER(this->metrics, PHASE_UPDATE);
+            if (this->sweep_mode == SWEEP_SYNCHRONOUS) {
+                max_delta = this->SynchronousSweep(trivial);
+            } else if (this->sweep_mode == SWEEP_COLOURED) {
+                max_delta = this->ColouredSweep(generator, trivial);
+            } else if (this->sweep_mode == SWEEP_RESIDUAL) {
+                max_delta = this->ResidualSweep(trivial);
+            } else {
+                max_delta = this->SequentialSweep(generator, clauses_indexes, trivial);
             }
         }
+#ifdef SP_METRICS
+        this->metrics.sweeps++;
+        if (this->sweep_mode != SWEEP_RESIDUAL) {
+            this->metrics.edge_updates += sweep_edges;
+        }
+#endif
+#ifdef SP_COUNT_ALLOCATIONS
+        if (iters > 0) {
+            this->iteration_allocations = std::max(this->iteration_allocations, AllocationCount - allocations);
+        }
+#endif
         // Check the convergence condition.
-        for (int i = 0; i < prev_warnings.size(); i++) {
-            for (int j = 0; j < prev_warnings[i].size(); j++) {
-                trivial = trivial ? this->AssociatedGraph->getEdgeW(i, j) == 0.0 : trivial;
-                if (std::abs(this->AssociatedGraph->getEdgeW(i, j) - prev_warnings[i][j]) > this->precision) {
-                    converged = false;
-                }
+        if (max_delta <= this->precision) {
+            this->StoreSurveys();
+            if (this->incremental) {
+                this->InitWarmState();
             }
-        }
-        // If the variable is true, means that all the the edge
-        if (converged) {
             return SP_CONVERGED;
         }
+        if (this->adaptive_damping) {
+            this->TrackOscillations(max_delta);
+        }
+        if (this->cancel != nullptr && this->cancel->load(std::memory_order_relaxed)) {
+            break;
+        }
     }
+    this->StoreSurveys();
     return SP_UNCONVERGED;
 }
 
-void SurveyPropagation::CalculateBiases(vector<double> &positive_w, vector<double> &negative_w, vector<double> &zero_w,
-                                        int &max_index) {
+template <typename Real>
+void SurveyPropagation<Real>::CalculateBiases(vector<double> &positive_w, vector<double> &negative_w,
+                                              vector<double> &zero_w, int &max_index) {
+    METRICS_TIMER(this->metrics, PHASE_BIASES);
     if (!positive_w.empty()) {
         positive_w.clear();
     }
@@ -130,48 +804,53 @@ void SurveyPropagation::CalculateBiases(vector<double> &positive_w, vector<doubl
         zero_w.clear();
     }
 
-    positive_w.resize(this->AssociatedGraph->getNVariables());
-    negative_w.resize(this->AssociatedGraph->getNVariables());
-    zero_w.resize(this->AssociatedGraph->getNVariables());
+    int n_variables = this->AssociatedGraph->getNVariables();
+    positive_w.resize(n_variables);
+    negative_w.resize(n_variables);
+    zero_w.resize(n_variables);
     max_index = 0;
 
-    unsigned int variable_index;
-    double positive_pi, negative_pi, zero_pi, pos_prod, neg_prod, survey, max = 0.0;
+    View<unsigned int> edges;
+    double max = 0.0;
 
-    // For each variable we have to calculate the three pis.
-    for (int variable = 1; variable <= this->AssociatedGraph->getNVariables(); variable++) {
-        variable_index = variable - 1;
-        pos_prod = 1.0;
-        neg_prod = 1.0;
-        zero_pi = 1.0;
-
-        // Positive PI of variable
-        for (auto it : this->AssociatedGraph->getPositiveClausesOfVariable(variable)) {
-            survey = 1 - this->AssociatedGraph->getEdgeW(it, this->AssociatedGraph->getIndexOfVariable(it, variable));
-            pos_prod *= survey;
-            zero_pi *= survey;
-        }
-        // Negative PI of variable
-        for (auto it : this->AssociatedGraph->getNegativeClausesOfVariable(variable)) {
-            survey = 1 - this->AssociatedGraph->getEdgeW(it, this->AssociatedGraph->getIndexOfVariable(it, -variable));
-            neg_prod *= survey;
-            zero_pi *= survey;
-        }
-        positive_pi = (1.0 - pos_prod) * neg_prod;
-        negative_pi = (1.0 - neg_prod) * pos_prod;
-
-        positive_w[variable_index] = positive_pi / (positive_pi + negative_pi + zero_pi);
-        negative_w[variable_index] = negative_pi / (positive_pi + negative_pi + zero_pi);
-        zero_w[variable_index] = 1.0 - positive_w[variable_index] - negative_w[variable_index];
-        double difference = std::abs(positive_w[variable_index] - negative_w[variable_index]);
+    // The products of each variable are gathered first, they are kept in positive_w and negative_w.
+    for (int variable = 1; variable <= n_variables; variable++) {
+        edges = this->AssociatedGraph->getPositiveEdgesOfVariable(variable);
+        positive_w[variable - 1] = CavityProduct(this->surveys.data(), edges.begin(), edges.size(), NO_EDGE);
+        edges = this->AssociatedGraph->getNegativeEdgesOfVariable(variable);
+        negative_w[variable - 1] = CavityProduct(this->surveys.data(), edges.begin(), edges.size(), NO_EDGE);
+    }
+    // For each variable we have to calculate the three pis. The loop doesn't depend on the previous variables, so it
+    // is vectorized.
+    #pragma omp simd
+    for (int i = 0; i < n_variables; i++) {
+        double pos_prod = positive_w[i], neg_prod = negative_w[i];
+        double positive_pi = (1.0 - pos_prod) * neg_prod, negative_pi = (1.0 - neg_prod) * pos_prod;
+        double zero_pi = pos_prod * neg_prod;
+
+        positive_w[i] = positive_pi / (positive_pi + negative_pi + zero_pi);
+        negative_w[i] = negative_pi / (positive_pi + negative_pi + zero_pi);
+        zero_w[i] = 1.0 - positive_w[i] - negative_w[i];
+    }
+    for (int i = 0; i < n_variables; i++) {
+        double difference = std::abs(positive_w[i] - negative_w[i]);
         if (difference > max) {
             max = difference;
-            max_index = variable;
+            max_index = i + 1;
         }
     }
 }
 
-int SurveyPropagation::SID(vector<bool> &true_assignment, unsigned int sid_iters) {
+template <typename Real>
+void SurveyPropagation<Real>::GraphAssignment(vector<bool> &true_assignment) const {
+    true_assignment.resize(this->AssociatedGraph->getNVariables());
+    for (int variable = 1; variable <= this->AssociatedGraph->getNVariables(); variable++) {
+        true_assignment[variable - 1] = this->AssociatedGraph->getAssignment(variable) > 0;
+    }
+}
+
+template <typename Real>
+int SurveyPropagation<Real>::SID(vector<bool> &true_assignment, unsigned int sid_iters) {
    if (!true_assignment.empty()) {
         true_assignment.clear();
     }
@@ -181,7 +860,8 @@ int SurveyPropagation::SID(vector<bool> &true_assignment, unsigned int sid_iters
     int max_index;
     vector<int> fixed_variables;
     vector<double> positive_w, negative_w, zero_w;
-    for (int iter = 0; iter < sid_iters; iter++) {
+    for (int iter = 0; iter < sid_iters && (this->cancel == nullptr || !this->cancel->load(std::memory_order_relaxed));
+         iter++) {
         // The surveys are randomized by default.
         if (this->SP(trivial_surveys) == SP_CONVERGED) {
             std::cout << "Survey propagation has converged" << std::endl;
@@ -190,29 +870,32 @@ int SurveyPropagation::SID(vector<bool> &true_assignment, unsigned int sid_iters
             if (trivial_surveys) {
                 std::cout << "The surveys are trivial, starting local search." << std::endl;
                 true_assignment = this->AssociatedGraph->WalkSAT(this->walksat_iters, this->walksat_flips,
-                                                                this->walksat_noise, vector<int>());
+                                                                this->walksat_noise, vector<int>(),
+                                                                this->walksat_threads, this->cancel);
                 return true_assignment.empty() ? PROB_UNSAT : SAT;
 
             } else {
                 std::cout << "The survey are not trivial." << std::endl;
                 this->CalculateBiases(positive_w, negative_w, zero_w, max_index);
-                assign = positive_w[max_index] > negative_w[max_index];
-
-                fixed_variables.push_back(assign ? max_index + 1 : -(max_index + 1));
-                true_assignment[max_index] = assign;
-                this->AssociatedGraph->PartialAssignment(max_index, assign);
-                // Calling unit propagation with the assignment applied.
-                this->AssociatedGraph->UnitPropagation();
-                // If there is a contradiction, we return CONTRADICTION
-                if (AssociatedGraph->Contradiction()) {
+                // max_index is the variable (starting at 1) with the highest bias, it is 0 if every bias is 0.
+                if (max_index > 0) {
+                    assign = positive_w[max_index - 1] > negative_w[max_index - 1];
+                    fixed_variables.push_back(assign ? max_index : -max_index);
+                    this->AssociatedGraph->PartialAssignment(max_index - 1, assign);
+                }
+                // Calling unit propagation with the assignment applied. If there is a contradiction, we return
+                // CONTRADICTION
+                if (!this->AssociatedGraph->UnitPropagation()) {
                     true_assignment.clear();
                     return CONTRADICTION;
                 } else if (AssociatedGraph->EmptyClause()) {  // If the graph is the empty clause we return SAT.
+                    this->GraphAssignment(true_assignment);
                     return SAT;
                 }
 
                 true_assignment = this->AssociatedGraph->WalkSAT(this->walksat_iters, this->walksat_flips,
-                                                                this->walksat_noise, fixed_variables);
+                                                                this->walksat_noise, fixed_variables,
+                                                                this->walksat_threads, this->cancel);
                 if(!true_assignment.empty()) {
                     for (int i : fixed_variables) {
                         true_assignment[i > 0 ? i - 1 : abs(i) - 1] = i > 0;
@@ -230,7 +913,8 @@ int SurveyPropagation::SID(vector<bool> &true_assignment, unsigned int sid_iters
     return PROB_UNSAT;
 }
 
-int SurveyPropagation::SIDF(vector<bool> &true_assignment, double f) {
+template <typename Real>
+int SurveyPropagation<Real>::SIDF(vector<bool> &true_assignment, double f) {
 
     if (!true_assignment.empty()) {
         true_assignment.clear();
@@ -256,23 +940,26 @@ int SurveyPropagation::SIDF(vector<bool> &true_assignment, double f) {
                 return std::abs(positive_w[w1] - negative_w[w1]) > std::abs(positive_w[w2] - negative_w[w2]);
             });
 
-            for (int i = 0; i < nvars; i++) {
-                bool assign = std::abs(positive_w[ordered_indexes[i]]) > std::abs(negative_w[ordered_indexes[i]]);
-                this->AssociatedGraph->PartialAssignment(ordered_indexes[i], assign);
-                // Update the true assignment vector with the selected clause.
-                true_assignment[ordered_indexes[i]] =  assign;
-                fixed_variables.push_back(assign ? ordered_indexes[i] + 1: -(ordered_indexes[i] + 1));
-                // If there is a contradiction, we return CONTRADICTION
-                if (AssociatedGraph->Contradiction()) {
-                    true_assignment.clear();
-                    std::cerr << "A contradiction was founded" << std::endl;
-                    return CONTRADICTION;
-                // If the graph is the empty clause we return SAT.
-                } else if (AssociatedGraph->EmptyClause()) {
-                    return SAT;
+            // The variables with the higher biases that are not assigned yet (the formula could have unit clauses) are
+            // fixed together.
+            for (int i = 0; i < ordered_indexes.size() && fixed_variables.size() < nvars; i++) {
+                int variable = static_cast<int>(ordered_indexes[i]) + 1;
+                if (this->AssociatedGraph->getAssignment(variable) == 0) {
+                    bool assign = positive_w[variable - 1] > negative_w[variable - 1];
+                    fixed_variables.push_back(assign ? variable : -variable);
                 }
-                // Calling unit propagation with the assignment applied.
-                this->AssociatedGraph->UnitPropagation();
+            }
+            // The unit clauses are propagated once every variable is fixed. If there is a contradiction, we return
+            // CONTRADICTION.
+            if (!this->AssociatedGraph->PartialAssignment(fixed_variables) ||
+                !this->AssociatedGraph->UnitPropagation()) {
+                true_assignment.clear();
+                std::cerr << "A contradiction was founded" << std::endl;
+                return CONTRADICTION;
+            // If the graph is the empty clause we return SAT.
+            } else if (AssociatedGraph->EmptyClause()) {
+                this->GraphAssignment(true_assignment);
+                return SAT;
             }
         }
     } else {
@@ -283,7 +970,8 @@ int SurveyPropagation::SIDF(vector<bool> &true_assignment, double f) {
     }
 
     true_assignment = this->AssociatedGraph->WalkSAT(this->walksat_iters, this->walksat_flips,
-                                                    this->walksat_noise, fixed_variables);
+                                                    this->walksat_noise, fixed_variables,
+                                                    this->walksat_threads, this->cancel);
     if (!true_assignment.empty()) {
         for (int i : fixed_variables) {
             true_assignment[abs(i) - 1] = i > 0;
@@ -291,3 +979,6 @@ int SurveyPropagation::SIDF(vector<bool> &true_assignment, double f) {
     }
     return true_assignment.empty() ? PROB_UNSAT : SAT;
 }
+
+template class SurveyPropagation<double>;
+template class SurveyPropagation<float>;
@@ -0,0 +1,54 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#include "WorkStealingPool.h"
+
+WorkStealingPool::WorkStealingPool(unsigned int n_threads) : n_threads(n_threads == 0 ? 1 : n_threads),
+                                                             queues(this->n_threads), mutexes(this->n_threads) {}
+
+bool WorkStealingPool::NextJob(unsigned int worker, std::size_t &job) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutexes[worker]);
+        if (!this->queues[worker].empty()) {
+            job = this->queues[worker].front();
+            this->queues[worker].pop_front();
+            return true;
+        }
+    }
+    // Steal from the other workers, starting with the next one.
+    for (unsigned int i = 1; i < this->n_threads; i++) {
+        unsigned int victim = (worker + i) % this->n_threads;
+        std::lock_guard<std::mutex> lock(this->mutexes[victim]);
+        if (!this->queues[victim].empty()) {
+            job = this->queues[victim].back();
+            this->queues[victim].pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::Work(unsigned int worker, const std::function<void(std::size_t)> &run) {
+    std::size_t job;
+    // No job is added while the batch runs, so a worker can leave when it doesn't find any.
+    while (this->NextJob(worker, job)) {
+        run(job);
+    }
+}
+
+void WorkStealingPool::Run(std::size_t n_jobs, const std::function<void(std::size_t)> &run) {
+    for (unsigned int w = 0; w < this->n_threads; w++) {
+        for (std::size_t job = n_jobs * w / this->n_threads; job < n_jobs * (w + 1) / this->n_threads; job++) {
+            this->queues[w].push_back(job);
+        }
+    }
+    vector<std::thread> threads;
+    for (unsigned int w = 1; w < this->n_threads; w++) {
+        threads.emplace_back(&WorkStealingPool::Work, this, w, std::cref(run));
+    }
+    this->Work(0, run);
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
@@ -0,0 +1,61 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#include <iostream>
+#include "SurveyPropagation.h"
+
+using namespace std;
+
+/*
+ * Global operator new that counts the heap allocations in AllocationCount. It is only linked in this executable, so the
+ * other executables use the operator new of the standard library.
+ */
+void *operator new(std::size_t size) {
+    AllocationCount++;
+    if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+/**
+ * @brief Function that checks that the SP iterations don't make heap allocations once the buffers are created.
+ * @param formula: Formula (inside CNF_PATH) that will be used.
+ * @param mode: Sweep mode of SP.
+ * @return 0 if no SP iteration has allocated memory and 1 in other case.
+ */
+int CheckAllocations(const string &formula, int mode) {
+    std::vector<bool> assignment;
+    SurveyPropagation sp(CNF_PATH + formula, 7, 20);
+    sp.setSweepMode(mode);
+    // The result doesn't matter, only the allocations of the SP iterations.
+    (void) sp.SIDF(assignment, 0.04);
+    cout << "Allocations in a SP iteration (mode " << mode << "): " << sp.getIterationAllocations() << endl;
+    return sp.getIterationAllocations() == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Check the allocations of the SP iterations with each sweep mode. Usage: sp_alloc_check [formula].
+ * @return 0 if no SP iteration has allocated memory and 1 in other case.
+ */
+int main(int argc, char **argv) {
+    if (argc > 2) {
+        cerr << "Usage: " << argv[0] << " [formula]" << endl;
+        return 1;
+    }
+    string formula = argc == 2 ? argv[1] : "/cnf_6000_6875.cnf";
+    int failed = 0;
+    for (int mode : {SWEEP_SEQUENTIAL, SWEEP_SYNCHRONOUS, SWEEP_COLOURED}) {
+        failed += CheckAllocations(formula, mode);
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#include <iostream>
+#include <chrono>
+#include <filesystem>
+#include "SurveyPropagation.h"
+
+using namespace std;
+using namespace std::chrono;
+
+/** Minimum time in seconds that each benchmark is repeated. */
+#define BENCH_MIN_TIME 0.2
+/** Minimum number of runs of each benchmark. */
+#define BENCH_MIN_RUNS 5
+/** Maximum number of runs of each benchmark. */
+#define BENCH_MAX_RUNS 1000
+/** Ratio of clauses to variables of the generated formulas (close to the SAT-UNSAT threshold of 3-SAT). */
+#define BENCH_ALPHA 4.2
+
+/**
+ * @brief Formula used by the benchmarks.
+ */
+struct BenchInstance {
+    /** Name of the instance in the output. */
+    string name;
+    /** Path of the DIMACS file. It is empty if the formula is a random 3-SAT formula generated in memory. */
+    string path;
+    /** Number of variables of the random formula. */
+    unsigned int n_variables;
+};
+
+/**
+ * @brief Microbenchmarks of the solver kernels. It is a friend of FactorGraph and SurveyPropagation, so it can call the
+ * private kernels (the updates, the sweeps, CalculateBiases and the WalkSAT flips) directly.
+ */
+struct SolverBench {
+    /** Only the benchmarks whose name starts with filter are run. */
+    string filter;
+
+    /**
+     * @brief Run a benchmark several times and print its result as a JSON object in a line: the median and the minimum
+     * time per operation of the runs. There is a warm up run that is not measured.
+     * @param name: Name of the benchmark.
+     * @param instance: Instance used by the benchmark.
+     * @param graph: Graph of the instance.
+     * @param ops: Number of operations made by each run.
+     * @param run: Function that makes a run. The time spent in setup (a function called before each run) is not
+     * measured.
+     * @param setup: Function called before each run.
+     */
+    template <typename Run, typename Setup>
+    void Measure(const string &name, const BenchInstance &instance, const FactorGraph &graph, std::size_t ops,
+                 Run run, Setup setup) const {
+        vector<double> times;
+        double total = 0.0;
+        if (name.compare(0, this->filter.size(), this->filter) != 0 || ops == 0) {
+            return;
+        }
+        setup();
+        run();
+        while (times.size() < BENCH_MAX_RUNS && (times.size() < BENCH_MIN_RUNS || total < BENCH_MIN_TIME)) {
+            setup();
+            auto start = steady_clock::now();
+            run();
+            times.push_back(duration<double>(steady_clock::now() - start).count());
+            total += times.back();
+        }
+        std::sort(times.begin(), times.end());
+        cout << "{\"benchmark\": \"" << name << "\", \"instance\": \"" << instance.name << "\", \"variables\": "
+             << graph.getNVariables() << ", \"clauses\": " << graph.getNClauses() << ", \"edges\": "
+             << graph.getNEdges() << ", \"runs\": " << times.size() << ", \"ops_per_run\": " << ops
+             << ", \"median_ns_per_op\": " << times[times.size() / 2] * 1e9 / ops << ", \"min_ns_per_op\": "
+             << times.front() * 1e9 / ops << "}" << endl;
+    }
+
+    /**
+     * @brief Run every benchmark with an instance.
+     * @param instance: Instance used by the benchmarks.
+     */
+    void Run(const BenchInstance &instance) const {
+        auto nothing = []() {};
+        auto load = [&instance]() {
+            return instance.path.empty() ? std::make_unique<FactorGraph>(instance.n_variables, BENCH_ALPHA, 3, 7) :
+                                           std::make_unique<FactorGraph>(instance.path);
+        };
+        unique_ptr<FactorGraph> loaded = load();
+        FactorGraph &graph = *loaded;
+        // The files are parsed and the random formulas are generated.
+        this->Measure(instance.path.empty() ? "generate" : "read_dimacs", instance, graph, 1, [&load]() {
+            (void) load();
+        }, nothing);
+        SurveyPropagation<double> sp(graph, 7);
+        std::mt19937 generator(7);
+        std::uniform_int_distribution<unsigned int> variables(0, graph.getNVariables() - 1);
+        std::size_t edges = graph.getNEdges(), fixed = graph.getNVariables() / 100 + 1;
+        View<unsigned int> active = graph.getActiveClauses();
+        uvector clauses_indexes(active.begin(), active.end());
+        vector<double> positive_w, negative_w, zero_w;
+        double delta = 0.0;
+        bool trivial;
+        int max_index;
+
+        // The updates and the sweeps work on the surveys of the solver.
+        sp.LoadSurveys();
+        sp.InitProducts();
+        this->Measure("update", instance, graph, edges, [&sp, &edges, &delta]() {
+            for (unsigned int e = 0; e < edges; e++) {
+                delta += sp.Update(e);
+            }
+        }, nothing);
+        this->Measure("update_cached", instance, graph, edges, [&sp, &edges, &delta]() {
+            for (unsigned int e = 0; e < edges; e++) {
+                delta += sp.UpdateCached(e);
+            }
+        }, nothing);
+        this->Measure("sp_sweep", instance, graph, 1, [&sp, &generator, &clauses_indexes, &delta, &trivial]() {
+            delta += sp.SequentialSweep(generator, clauses_indexes, trivial);
+        }, nothing);
+        // The same sweep without the fixed width kernels.
+        unsigned int clause_width = sp.clause_width;
+        sp.clause_width = 0;
+        this->Measure("sp_sweep_generic", instance, graph, 1, [&sp, &generator, &clauses_indexes, &delta, &trivial]() {
+            delta += sp.SequentialSweep(generator, clauses_indexes, trivial);
+        }, nothing);
+        sp.clause_width = clause_width;
+        this->Measure("calculate_biases", instance, graph, 1, [&]() {
+            sp.CalculateBiases(positive_w, negative_w, zero_w, max_index);
+        }, nothing);
+
+        // The decimation benchmarks fix 1% of the variables and backtrack the graph after each run.
+        FactorGraph &decimated = *sp.AssociatedGraph;
+        std::size_t level = decimated.getTrailSize();
+        vector<unsigned int> picks(fixed);
+        auto pick = [&]() {
+            decimated.Backtrack(level);
+            for (auto &v : picks) {
+                v = variables(generator);
+            }
+        };
+        this->Measure("partial_assignment", instance, graph, fixed, [&decimated, &picks]() {
+            for (auto v : picks) {
+                decimated.PartialAssignment(v, v % 2 == 0);
+            }
+        }, pick);
+        this->Measure("unit_propagation", instance, graph, 1, [&decimated]() {
+            (void) decimated.UnitPropagation();
+        }, [&]() {
+            pick();
+            for (auto v : picks) {
+                decimated.PartialAssignment(v, v % 2 == 0);
+            }
+        });
+        decimated.Backtrack(level);
+
+        WalkSATState state;
+        graph.InitWalkSAT(state, generator);
+        picks.resize(edges);
+        for (auto &v : picks) {
+            v = variables(generator);
+        }
+        this->Measure("walksat_flip", instance, graph, picks.size(), [&graph, &state, &picks]() {
+            for (auto v : picks) {
+                graph.FlipVariable(state, v);
+            }
+        }, nothing);
+        // The results are used, so the loops are not removed by the compiler.
+        if (delta < 0.0) {
+            cerr << delta << endl;
+        }
+    }
+};
+
+/**
+ * @brief Microbenchmarks of the solver kernels with the formulas of CNF_PATH and random 3-SAT formulas of increasing
+ * size, which are generated in memory. Each result is printed as a JSON object in a line. Usage: sp_bench [filter]
+ * [max_variables]. Only the benchmarks whose name starts with filter (read_dimacs, generate, update, update_cached,
+ * sp_sweep, sp_sweep_generic, calculate_biases, partial_assignment, unit_propagation or walksat_flip) are run. The
+ * random formulas have from 10^3 to max_variables variables (10^5 by default).
+ */
+int main(int argc, char **argv) {
+    if (argc > 3) {
+        cerr << "Usage: " << argv[0] << " [filter] [max_variables]" << endl;
+        return 1;
+    }
+    SolverBench bench{argc >= 2 ? argv[1] : ""};
+    unsigned long max_variables = argc == 3 ? std::stoul(argv[2]) : 100000;
+    vector<BenchInstance> instances;
+    for (const auto &entry : filesystem::directory_iterator(CNF_PATH)) {
+        if (entry.path().extension() == ".cnf") {
+            instances.push_back({entry.path().stem().string(), entry.path().string(), 0});
+        }
+    }
+    std::sort(instances.begin(), instances.end(), [](const BenchInstance &i1, const BenchInstance &i2) {
+        return std::filesystem::file_size(i1.path) < std::filesystem::file_size(i2.path);
+    });
+    for (unsigned long n = 1000; n <= max_variables; n *= 10) {
+        instances.push_back({"random_3sat_" + to_string(n), "", static_cast<unsigned int>(n)});
+    }
+
+    for (const auto &instance : instances) {
+        bench.Run(instance);
+    }
+    return 0;
+}
@@ -0,0 +1,33 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#include <iostream>
+#include "FactorGraph.h"
+
+using namespace std;
+
+/**
+ * @brief Convert a formula between the DIMACS and the binary factor graph formats. The input format is detected by
+ * its first bytes. The output is a DIMACS file if its path ends in ".cnf" and a binary factor graph file in other case.
+ * Usage: SPConvert input output [--surveys]. With --surveys the binary file also stores the surveys of the edges.
+ */
+int main(int argc, char **argv) {
+    if (argc < 3 || (argc == 4 && string(argv[3]) != "--surveys") || argc > 4) {
+        cerr << "Usage: " << argv[0] << " input output [--surveys]" << endl;
+        return 1;
+    }
+    string output = argv[2];
+    FactorGraph graph(argv[1]);
+
+    if (output.size() >= 4 && output.compare(output.size() - 4, 4, ".cnf") == 0) {
+        ofstream output_file(output);
+        if (!(output_file << graph)) {
+            cerr << "The file " << output << " can't be written" << endl;
+            return 1;
+        }
+    } else {
+        graph.WriteBinary(output, argc == 4);
+    }
+    return 0;
+}
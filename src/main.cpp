@@ -1,7 +1,9 @@
 #include <iostream>
 #include "SurveyPropagation.h"
+#include "WorkStealingPool.h"
 #include <filesystem>
 #include <chrono>
+#include <memory>
 #include <omp.h>
 
 using namespace std;
@@ -71,74 +73,177 @@ string PrintSurveyPropagationResults(int sol) {
     return res;
 }
 
-void Experiment(int N, const string& result = "/bin/results.csv") {
-    std::vector<bool> assignment;
+/**
+ * @brief Job of the Experiment batch: a formula solved by SIDF with a fraction.
+ */
+struct ExperimentJob {
+    /** Index of the alpha of the formula. */
+    int alpha{0};
+    /** Index of the fraction. */
+    int fraction{0};
+    /** Index of the formula. */
+    std::size_t formula{0};
+    /** Result of SIDF. */
+    int result{0};
+    /** True if the assignment found by SIDF satisfies the formula. */
+    bool valid{false};
+    /** Time of SIDF in milliseconds. */
+    long unsigned int time{0};
+#ifdef SP_METRICS
+    /** Counters and timers of the phases of SIDF. */
+    SolverMetrics metrics{};
+#endif
+};
+
+/**
+ * @brief Run SIDF over the formulas of each alpha with each fraction and save the ratio of solved formulas in a CSV
+ * table. Each formula is parsed once (the parser uses OpenMP) and the (formula, fraction) jobs run in a work-stealing
+ * pool. The fractions are tried in rounds: each round runs the next fraction of every alpha that still has unsolved
+ * formulas, so the fractions after the first one that solves every formula of an alpha are not run. The results of a
+ * round are merged in order, so the table doesn't depend on the number of threads. If the code is compiled with
+ * SP_METRICS, the metrics of the jobs of each alpha are added and saved as JSON in metrics.json (next to the CSV file).
+ * @param N: Number of variables of the formulas (folder inside testCNF).
+ * @param result: Path of the CSV file (inside BIN_PATH).
+ * @param n_threads: Number of threads of the pool. Defaults to the number of hardware threads.
+ * @param random_formulas: If it is not 0, the formulas aren't read from testCNF: random_formulas random 3-SAT formulas
+ * of each alpha are generated in memory (see FactorGraph). Defaults to 0.
+ */
+void Experiment(int N, const string& result = "/bin/results.csv",
+                unsigned int n_threads = std::thread::hardware_concurrency(), unsigned int random_formulas = 0) {
     std::ofstream out_file(BIN_PATH + result);
     vector<double> fractions = {0.04, 0.02, 0.01, 0.005, 0.0025, 0.00125};
     vector<double> alphas = {4.21, 4.22, 4.23, 4.24};
     vector<double>times;
     vector<vector<double>> table (fractions.size(), vector<double>(alphas.size(), 0.0));
+    WorkStealingPool pool(n_threads);
+
+    // Formulas of each alpha: the formulas of alpha a are in [first_formula[a], first_formula[a + 1]).
+    // The random formulas are named by their parameters.
+    vector<string> paths;
+    vector<double> formula_alphas;
+    vector<std::size_t> first_formula(alphas.size() + 1, 0);
+    for (int alpha = 0; alpha < alphas.size(); alpha++) {
+        std::stringstream p;
+        if (random_formulas == 0) {
+            p << "/testCNF/" << N << "/" << std::setprecision(3) << alphas[alpha];
+            initializeCnfFolder(p.str());
+            paths.insert(paths.end(), cnf_folder.begin(), cnf_folder.end());
+        } else {
+            for (unsigned int i = 0; i < random_formulas; i++) {
+                p.str("");
+                p << "random(N=" << N << ", alpha=" << std::setprecision(3) << alphas[alpha] << ", seed=" << paths.size()
+                  << ")";
+                paths.push_back(p.str());
+            }
+        }
+        formula_alphas.resize(paths.size(), alphas[alpha]);
+        first_formula[alpha + 1] = paths.size();
+    }
+    // Each formula is parsed (or generated with the index of the formula as seed) once, its jobs only read it. The
+    // formulas are loaded one by one outside the pool: the parser and the generator already use an OpenMP team.
+    vector<std::unique_ptr<FactorGraph>> graphs(paths.size());
+    for (std::size_t i = 0; i < paths.size(); i++) {
+        if (random_formulas == 0) {
+            graphs[i] = std::make_unique<FactorGraph>(paths[i], 7);
+        } else {
+            graphs[i] = std::make_unique<FactorGraph>(N, formula_alphas[i], 3, static_cast<int>(i));
+        }
+    }
 
-    int solved_formulas, unconverged, false_positives, unsat;
-    long unsigned int alpha_time;
     out_file << "fractions/alphas,";
     for (auto i : alphas) {
         out_file << i << ",";
     }
     out_file << endl;
-    int n_files;
-    bool not_solved;
-    for (int alpha = 0; alpha < alphas.size(); alpha++) {
-        not_solved = true;
-        alpha_time = 0;
-        for (int frac = 0; frac < fractions.size() && not_solved; frac++) {
-            solved_formulas = unconverged = unsat = false_positives = 0;
-            std::stringstream p;
-            p << "/testCNF/" << N << "/" << std::setprecision(3) << alphas[alpha];
-            initializeCnfFolder(p.str());
-            n_files = 0;
-            for (const auto &path : cnf_folder) {
-                n_files++;
-                FactorGraph orig(path, 5);
-                SurveyPropagation SP(path, 7);
-                auto time_1 = high_resolution_clock::now();
-                int res = SP.SIDF(assignment, fractions[frac]);
-                auto time_2 = high_resolution_clock::now();
-                alpha_time += duration_cast<milliseconds>(time_2 - time_1).count();
-                switch (res) {
-                    case SAT:
-                        if (orig.CheckAssignment(assignment)) {
-                            solved_formulas++;
-                            table[frac][alpha]++;
-                        } else {
-                            cout << "False positive in path: " << path << std::endl;
-                            false_positives++;
-                        }
-                        break;
-                    case SP_UNCONVERGED:
-                        unconverged++;
-                        cout << "SP didn't converged using the formula " << path << endl;
-                        break;
-                    case PROB_UNSAT:
-                        unsat++;
-                        cout << "Formula " << path << " is unsatisfiable" << endl;
-                        break;
-                    case CONTRADICTION:
-                        cerr << "Contradiction founded in " << path << endl;
-                        break;
-                    default:
-                        break;
-                }
+    // Next fraction of each alpha (n_fractions when the alpha is finished) and time of its jobs.
+    const int n_fractions = static_cast<int>(fractions.size());
+    vector<int> next_fraction(alphas.size(), 0);
+    vector<long unsigned int> alpha_times(alphas.size(), 0);
+#ifdef SP_METRICS
+    vector<SolverMetrics> alpha_metrics(alphas.size());
+#endif
+    vector<ExperimentJob> jobs;
+    while (true) {
+        jobs.clear();
+        for (int alpha = 0; alpha < alphas.size(); alpha++) {
+            if (next_fraction[alpha] == n_fractions) {
+                continue;
+            }
+            for (std::size_t f = first_formula[alpha]; f < first_formula[alpha + 1]; f++) {
+                ExperimentJob job;
+                job.alpha = alpha;
+                job.fraction = next_fraction[alpha];
+                job.formula = f;
+                jobs.push_back(job);
+            }
+        }
+        if (jobs.empty()) {
+            break;
+        }
+        pool.Run(jobs.size(), [&jobs, &graphs, &fractions](std::size_t j) {
+            ExperimentJob &job = jobs[j];
+            std::vector<bool> assignment;
+            SurveyPropagation SP(*graphs[job.formula], 7);
+            // The damping starts at 0 and is only increased when the surveys oscillate.
+            SP.setDamping(0.0, true);
+            auto time_1 = high_resolution_clock::now();
+            job.result = SP.SIDF(assignment, fractions[job.fraction]);
+            auto time_2 = high_resolution_clock::now();
+            job.time = duration_cast<milliseconds>(time_2 - time_1).count();
+            job.valid = job.result == SAT && graphs[job.formula]->CheckAssignment(assignment);
+#ifdef SP_METRICS
+            job.metrics = SP.getMetrics();
+#endif
+        });
+
+        // Merge the results of the round in order.
+        for (const auto &job : jobs) {
+            const string &path = paths[job.formula];
+            alpha_times[job.alpha] += job.time;
+#ifdef SP_METRICS
+            alpha_metrics[job.alpha] += job.metrics;
+#endif
+            switch (job.result) {
+                case SAT:
+                    if (job.valid) {
+                        table[job.fraction][job.alpha]++;
+                    } else {
+                        cout << "False positive in path: " << path << std::endl;
+                    }
+                    break;
+                case SP_UNCONVERGED:
+                    cout << "SP didn't converged using the formula " << path << endl;
+                    break;
+                case PROB_UNSAT:
+                    cout << "Formula " << path << " is unsatisfiable" << endl;
+                    break;
+                case CONTRADICTION:
+                    cerr << "Contradiction founded in " << path << endl;
+                    break;
+                default:
+                    break;
             }
-            not_solved = table[frac][alpha] != n_files;
         }
-        cout << "alpha = " << alphas[alpha] << endl;
+        // An alpha is finished when a fraction solves all its formulas or there are no more fractions.
+        for (int alpha = 0; alpha < alphas.size(); alpha++) {
+            if (next_fraction[alpha] == n_fractions) {
+                continue;
+            }
+            int n_files = first_formula[alpha + 1] - first_formula[alpha];
+            next_fraction[alpha] = table[next_fraction[alpha]][alpha] == n_files ? n_fractions :
+                                   next_fraction[alpha] + 1;
+            if (next_fraction[alpha] == n_fractions) {
+                cout << "alpha = " << alphas[alpha] << endl;
+            }
+        }
+    }
+    for (auto alpha_time : alpha_times) {
         times.push_back(alpha_time * 10e-3);
     }
     for (int f = 0; f < fractions.size(); f++) {
         out_file << fractions[f] << ",";
         for (int a = 0; a < alphas.size(); a++) {
-            out_file << (table[f][a] / n_files) << ",";
+            out_file << (table[f][a] / double(first_formula[a + 1] - first_formula[a])) << ",";
         }
         out_file << endl;
     }
@@ -148,6 +253,15 @@ void Experiment(int N, const string& result = "/bin/results.csv") {
     }
     out_file << endl;
     out_file.close();
+#ifdef SP_METRICS
+    std::ofstream metrics_file(BIN_PATH + std::filesystem::path(result).replace_filename("metrics.json").string());
+    metrics_file << "[";
+    for (int a = 0; a < alphas.size(); a++) {
+        metrics_file << (a == 0 ? "" : ",") << endl << "{\"alpha\": " << alphas[a] << ", \"metrics\": "
+                     << alpha_metrics[a].ToJSON() << "}";
+    }
+    metrics_file << endl << "]" << endl;
+#endif
 }
 
 void TestCNF() {
@@ -0,0 +1,69 @@
+//
+// Created by antoniomanuelfr on 10/17/26.
+//
+
+#include <iostream>
+#include "Portfolio.h"
+
+using namespace std;
+
+/** Number of variables of the random formula of the check. */
+#define CHECK_VARIABLES 200
+/** Ratio of clauses to variables of the random formula (far from the threshold, so it is satisfiable). */
+#define CHECK_ALPHA 3.0
+/** Number of attempts of the portfolio. */
+#define CHECK_ATTEMPTS 8
+
+/**
+ * @brief Function that runs a portfolio on a formula and checks its result.
+ * @param graph: Formula.
+ * @param n_threads: Number of threads of the portfolio.
+ * @param expected: Expected result of the portfolio.
+ * @return 0 if the check has passed and 1 in other case.
+ */
+int CheckPortfolio(const FactorGraph &graph, unsigned int n_threads, int expected) {
+    vector<bool> assignment;
+    Portfolio portfolio(graph, n_threads);
+    portfolio.AddAttempts(CHECK_ATTEMPTS, PortfolioAttempt());
+    int result = portfolio.Run(assignment);
+    int winner = portfolio.getWinner();
+    const vector<int> &results = portfolio.getResults();
+    cout << "Portfolio with " << n_threads << " threads: result " << result << ", winner " << winner << endl;
+    if (result != expected) {
+        cerr << "The result should be " << expected << endl;
+        return 1;
+    }
+    if (result != SAT) {
+        return winner == -1 && assignment.empty() ? 0 : 1;
+    }
+    if (winner == -1 || !graph.CheckAssignment(assignment)) {
+        cerr << "The assignment of the winner doesn't satisfy the formula" << endl;
+        return 1;
+    }
+    // With a single thread the attempts run in order, so every attempt after the winner is cancelled before it starts.
+    for (int i = winner + 1; n_threads == 1 && i < static_cast<int>(results.size()); i++) {
+        if (results[i] != PORTFOLIO_CANCELLED) {
+            cerr << "The attempt " << i << " hasn't been cancelled" << endl;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Check the portfolio: the first attempt that finds an assignment that satisfies a formula cancels the others
+ * and, if no attempt finds it, the results are combined. Usage: sp_portfolio_check [unsat formula].
+ * @return 0 if every check has passed and 1 in other case.
+ */
+int main(int argc, char **argv) {
+    if (argc > 2) {
+        cerr << "Usage: " << argv[0] << " [unsat formula]" << endl;
+        return 1;
+    }
+    FactorGraph satisfiable(CHECK_VARIABLES, CHECK_ALPHA, 3, 1);
+    // The aim formulas with "no" in their name are unsatisfiable.
+    FactorGraph unsatisfiable(argc == 2 ? argv[1] : CNF_PATH "/cnf_100_160.cnf");
+    int failed = CheckPortfolio(satisfiable, 1, SAT) + CheckPortfolio(satisfiable, 4, SAT) +
+                 CheckPortfolio(unsatisfiable, 2, PROB_UNSAT);
+    return failed == 0 ? 0 : 1;
+}